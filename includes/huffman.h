@@ -4,6 +4,7 @@
 // Importation des bibliothèques
 # include <stdbool.h>
 # include <stdint.h>
+# include <inttypes.h>
 # include <stdio.h>
 # include <stdlib.h>
 # include <string.h>
@@ -12,6 +13,13 @@
 # include <sys/stat.h>
 # include <time.h>
 # include <sys/time.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <pthread.h>
+# include <getopt.h>
+# include <dirent.h>
+# include <errno.h>
 
 // Hauteur maximale de l'arbre de Huffman
 # define MAX_TREE_HEIGHT 256
@@ -19,6 +27,133 @@
 // Nombre maximum de symboles uniques
 # define MAX_SYMBOLS 256 
 
+// Nombre maximum de noeuds d'un arbre : 2k - 1 pour k symboles
+# define HUFFMAN_TREE_SIZE (2 * MAX_SYMBOLS - 1)
+
+// Longueur maximale d'un code canonique (un code tient dans un mot de 64 bits)
+# define MAX_CODE_LENGTH 64
+
+// Limite par défaut des longueurs de codes (-L) : un code se décode en une lecture de table
+# define DEFAULT_CODE_LENGTH_LIMIT DECODE_TABLE_BITS
+
+// Signature et versions du format compressé
+# define HUFF_MAGIC "HUF"
+# define HUFF_VERSION_LEGACY 0    // Table de fréquences complète, sans signature
+# define HUFF_VERSION_CANONICAL 1 // Longueurs de codes canoniques compactées
+# define HUFF_VERSION_BLOCKS 2    // Suite de blocs ayant chacun leur table
+# define HUFF_VERSION_LARGE 3     // Blocs, puis taille totale sur 64 bits en fin de fichier
+# define HUFF_VERSION_DICT 4      // Table partagée désignée par son identifiant, sans table dans le fichier
+# define HUFF_VERSION_CHECKED 5   // Version 3 dont chaque bloc se termine par le CRC32C de ses octets décodés
+
+// Signature qui termine l'index des blocs (compress -i)
+# define HUFF_INDEX_MAGIC "HIDX"
+
+// Signature d'un fichier de table partagée (compress -t)
+# define HUFF_DICT_MAGIC "HUFD"
+
+// En-tête d'un fichier compressé avec une table : signature, identifiant 32 bits, taille 64 bits
+# define HUFF_DICT_HEADER_SIZE (4 + sizeof(uint32_t) + sizeof(uint64_t))
+
+// Taille des blocs écrits par le compresseur
+# define HUFF_BLOCK_SIZE (1 << 20)
+
+// Taille maximale d'un bloc acceptée par le décodeur
+# define HUFF_MAX_BLOCK_SIZE (64 << 20)
+
+// Nombre de blocs traités par thread dans chaque lot parallèle
+# define BLOCKS_PER_THREAD 2
+
+// Nombre de sous-histogrammes entrelacés pour le comptage des fréquences
+# define HISTOGRAM_WAYS 4
+
+/* Nombre d'octets comptés avant de reporter les sous-histogrammes 32 bits
+dans les compteurs 64 bits : aucun sous-compteur ne peut déborder */
+# define HISTOGRAM_SEGMENT ((size_t)1 << 30)
+
+// Taille minimale d'un morceau compté par un thread
+# define HISTOGRAM_MIN_CHUNK (256 << 10)
+
+/* Premier octet d'un bloc stocké sans codage, à la place de la longueur
+maximale des codes (jamais plus de MAX_CODE_LENGTH) : les octets bruts suivent */
+# define STORED_BLOCK 0xFF
+
+/* Premier octet d'un bloc codé avec une table par octet précédent (ordre 1),
+suivi des 256 tables de longueurs puis des codes */
+# define CONTEXT_BLOCK 0xFE
+
+/* Premier octet d'un bloc dont les codes sont répartis en SPLIT_STREAMS flux
+indépendants, décodés ensemble par le décodeur */
+# define SPLIT_BLOCK 0xFD
+
+// Nombre de flux d'un bloc SPLIT_BLOCK
+# define SPLIT_STREAMS 4
+
+// Taille minimale d'un bloc découpé en flux : en dessous, le gain est négligeable
+# define SPLIT_MIN_BLOCK (64 << 10)
+
+// Taille du contrôle (CRC32C) qui termine le contenu d'un bloc en version 5
+# define CHECKSUM_SIZE 4
+
+// Taille maximale de la table des longueurs (forme dense sur 8 bits)
+# define CODE_LENGTHS_MAX_SIZE (2 + MAX_SYMBOLS)
+
+/* Fraction du bloc (1/64) que l'entropie doit promettre de gagner, table
+comprise, pour que l'arbre soit construit : en dessous, le bloc est stocké */
+# define STORE_ENTROPY_MARGIN 64
+
+/* Taille maximale d'un bloc compressé de n octets : un code de Huffman fait
+en moyenne moins de 9 bits par symbole, plus la table des longueurs */
+# define HUFF_BLOCK_BOUND(n) ((size_t)(n) + (n) / 8 + CODE_LENGTHS_MAX_SIZE + 8)
+
+// Nombre de bits résolus par une lecture dans la table de décodage
+# define DECODE_TABLE_BITS 11
+
+/* Fonctions exportées par libhuffman.so. La bibliothèque est compilée avec
+-fvisibility=hidden : tout le reste de ce fichier sert aux outils, liés à
+libhuffman.a, et n'apparaît pas dans la table des symboles dynamiques */
+# define HUFF_API __attribute__((visibility("default")))
+
+// Codes de retour des fonctions huff_* de la bibliothèque
+# define HUFF_MORE 1            // huff_stream_flush, huff_stream_finish : sortie pleine, rappeler
+# define HUFF_OK 0
+# define HUFF_ERROR_MEMORY -1   // Allocation impossible
+# define HUFF_ERROR_DST_SIZE -2 // Buffer de destination trop petit
+# define HUFF_ERROR_CORRUPT -3  // Données compressées invalides ou tronquées
+# define HUFF_ERROR_DICTIONARY -4 // Fichier compressé avec une autre table
+
+// Sens d'un flux (huff_stream_init)
+# define HUFF_STREAM_COMPRESS 0
+# define HUFF_STREAM_DECOMPRESS 1
+
+// Alignement des allocations d'une arène (une ligne de cache)
+# define ARENA_ALIGN 64
+
+// Taille des blocs lus et écrits par la couche d'entrées/sorties
+# define IO_BLOCK_SIZE (1 << 20)
+
+// Phases chronométrées par l'instrumentation (--stats)
+# define STAT_READ 0       // Lecture de l'entrée
+# define STAT_HISTOGRAM 1  // Comptage des fréquences
+# define STAT_TREE 2       // Choix des longueurs de codes (arbre, package-merge)
+# define STAT_CODES 3      // Codes canoniques
+# define STAT_ENCODE 4     // Codage des symboles
+# define STAT_DECODE 5     // Décodage des blocs
+# define STAT_WRITE 6      // Écriture de la sortie
+# define STAT_CHECKSUM 7   // Calcul des CRC32C des blocs
+# define STAT_PHASES 8
+
+// Compteurs de l'instrumentation
+# define STAT_BYTES_IN 0      // Octets lus
+# define STAT_BYTES_OUT 1     // Octets écrits
+# define STAT_READ_CALLS 2    // Appels de lecture (read, fread, mmap)
+# define STAT_WRITE_CALLS 3   // Appels d'écriture (fwrite)
+# define STAT_BLOCKS 4        // Blocs compressés ou décodés
+# define STAT_STORED_BLOCKS 5 // Blocs stockés sans codage
+# define STAT_SYMBOLS 6       // Octets distincts de l'entrée (compression)
+# define STAT_CODED_BYTES 7   // Octets codés avec une seule table
+# define STAT_CODED_BITS 8    // Bits de codes de ces octets
+# define STAT_COUNTERS 9
+
 // Macro pour échanger deux valeurs
 # define SWAP(a, b)    \
 	{                 \
@@ -29,23 +164,32 @@
 
 typedef struct
 {
-	uint32_t	*frequencies;  // Liste des fréquences pour chaque symbole
+	uint64_t	*frequencies;  // Liste des fréquences pour chaque symbole
 	uint32_t total_symbols;    // Nombre de symboles uniques
-	uint32_t total_characters; // Nombre total de caractères dans le fichier
+	uint64_t total_characters; // Nombre total de caractères dans le fichier
 }				FrequencyTable;
 
-typedef struct HuffmanNode
+// Noeud de l'arbre : les fils sont des indices dans le tableau de HuffmanTree
+typedef struct
 {
+	uint64_t frequency;        // Fréquence d'apparition
+	int16_t left;              // Indice du fils gauche, -1 si aucun
+	int16_t right;             // Indice du fils droit, -1 si aucun
 	unsigned char character;   // Caractère stocké dans le noeud
-	uint32_t frequency;        // Fréquence d'apparition
-	struct HuffmanNode *left;  // Fils gauche
-	struct HuffmanNode *right; // Fils droit
 	bool is_leaf;              // Indique si le noeud est une feuille
 }			HuffmanNode;
 
+// Arbre de Huffman rangé dans un seul tableau, sans allocation par noeud
+typedef struct
+{
+	HuffmanNode	nodes[HUFFMAN_TREE_SIZE];
+	int			count;  // Nombre de noeuds utilisés
+	int			root;   // Indice de la racine, -1 si l'arbre est vide
+}				HuffmanTree;
+
 typedef struct
 {
-	uint8_t *code;   // Code binaire pour le symbole
+	uint64_t code;   // Code binaire pour le symbole, aligné à droite
 	uint32_t length; // Longueur du code en bits
 }			HuffmanCode;
 
@@ -53,6 +197,423 @@ typedef struct
 {
 	HuffmanCode codes[MAX_SYMBOLS]; // Table des codes pour chaque symbole
 	bool used[MAX_SYMBOLS];         // Indique quels symboles sont utilisés
+	int max_length;                 // Longueur du plus long code, 0 si inconnue
 }			HuffmanTable;
 
+// Fichier d'entrée chargé en une fois (projeté en mémoire ou lu par blocs)
+typedef struct
+{
+	unsigned char	*data;   // Contenu complet du fichier
+	size_t			size;    // Taille en octets
+	bool			mapped;  // true si data vient de mmap
+}				InputBuffer;
+
+// Sortie bufferisée : les octets sont écrits par blocs de IO_BLOCK_SIZE
+typedef struct
+{
+	FILE			*file;
+	unsigned char	*buffer; // IO_BLOCK_SIZE octets en attente d'écriture
+	size_t			pos;     // Nombre d'octets dans buffer
+	bool			error;   // Une écriture a échoué
+}				OutputBuffer;
+
+// Groupe de threads qui exécutent des lots de tâches indépendantes
+typedef struct
+{
+	pthread_t		*workers;
+	int				thread_count;  // Threads lancés, plus le thread appelant
+	pthread_mutex_t	lock;
+	pthread_cond_t	wakeup;        // Un nouveau lot est disponible
+	pthread_cond_t	finished;      // Toutes les tâches du lot sont terminées
+	void			(*job)(void *, size_t);
+	void			*context;
+	size_t			job_count;
+	size_t			next_job;
+	size_t			done_jobs;
+	uint64_t		generation;    // Incrémenté à chaque nouveau lot
+	bool			stopping;
+}				ThreadPool;
+
+// Réglages du compresseur, communs à tous les blocs
+typedef struct
+{
+	int				max_code_length;    // Longueur maximale d'un code (-L)
+	int				context_order;      // 1 : une table par octet précédent si c'est plus court (-O)
+	bool			write_index;        // Index des blocs en fin de fichier (-i)
+}				EncodeOptions;
+
+// Entrée de l'index : début d'un bloc dans les données décodées et dans le fichier
+typedef struct
+{
+	uint64_t		raw_offset;
+	uint64_t		packed_offset;  // Position de l'en-tête du bloc
+}				IndexEntry;
+
+// Index des blocs construit pendant la compression
+typedef struct
+{
+	IndexEntry		*entries;
+	size_t			count;
+	size_t			capacity;
+	uint64_t		raw_offset;     // Position décodée du prochain bloc
+	uint64_t		packed_offset;  // Position de l'en-tête du prochain bloc
+}				BlockIndex;
+
+// Modèle d'ordre 1 d'un bloc : une table de codes par octet précédent
+typedef struct
+{
+	uint32_t		counts[MAX_SYMBOLS][MAX_SYMBOLS];  // counts[précédent][octet]
+	uint8_t			lengths[MAX_SYMBOLS][MAX_SYMBOLS]; // Longueurs des codes de chaque contexte
+	bool			used[MAX_SYMBOLS];                 // Contexte rencontré dans le bloc
+	HuffmanTable	*codes[MAX_SYMBOLS];               // Codes canoniques, NULL si non rencontré
+}				ContextModel;
+
+/* Région de travail réutilisée d'un bloc à l'autre (arena.c) : les tables
+d'un bloc y sont prises à la suite et rendues ensemble par huff_arena_reset */
+typedef struct
+{
+	unsigned char	*base;      // Région contiguë
+	size_t			capacity;
+	size_t			used;       // Octets pris dans la région
+	size_t			needed;     // Octets demandés depuis le dernier reset, débordements compris
+	void			*overflow;  // Allocations qui n'ont pas tenu dans la région, chaînées
+}				HuffArena;
+
+// Un bloc en cours de compression ou de décompression dans un lot parallèle
+typedef struct
+{
+	unsigned char	*raw;               // Données décodées
+	size_t			raw_size;
+	size_t			raw_capacity;       // 0 si raw n'appartient pas au bloc
+	unsigned char	*packed;            // Bloc compressé (longueurs puis données)
+	size_t			packed_size;
+	size_t			packed_capacity;
+	bool			ok;
+	bool			checksum;           // packed se termine par le CRC32C de raw (décompression)
+	bool			seen[MAX_SYMBOLS];  // Symboles rencontrés (compression)
+	const EncodeOptions	*options;       // Réglages (compression)
+	HuffArena		arena;              // Tables du bloc, rendues avant le bloc suivant
+}				BlockJob;
+
+// Écriture des bits : les codes s'accumulent dans un mot de 64 bits
+typedef struct
+{
+	unsigned char	*dst;   // Bloc de sortie, dimensionné par HUFF_BLOCK_BOUND
+	size_t			pos;    // Nombre d'octets écrits dans dst
+	uint64_t		bits;   // Bits en attente, alignés à droite
+	uint32_t		count;  // Nombre de bits valides dans bits
+}				BitWriter;
+
+typedef struct
+{
+	uint16_t	entries[1 << DECODE_TABLE_BITS];      // Symbole (8 bits bas) | longueur du code, 0 = code plus long
+	const HuffmanTree *tree;                          // Arbre de l'ancien format, NULL pour les codes canoniques
+	int16_t		subtrees[1 << DECODE_TABLE_BITS];     // Noeud atteint après DECODE_TABLE_BITS bits (ancien format)
+	int			single_symbol;                        // Symbole unique à code vide (ancien format), -1 sinon
+	// Codes canoniques plus longs que DECODE_TABLE_BITS (chemin lent)
+	uint8_t		max_length;                           // Longueur du plus long code
+	uint64_t	first_code[MAX_CODE_LENGTH + 1];      // Premier code de chaque longueur
+	uint16_t	first_index[MAX_CODE_LENGTH + 1];     // Position de ce code dans symbols
+	uint16_t	count[MAX_CODE_LENGTH + 1];           // Nombre de codes de chaque longueur
+	unsigned char symbols[MAX_SYMBOLS];               // Symboles dans l'ordre canonique
+}			DecodeTable;
+
+/* Lecteur de bits : les bits sont alignés à gauche dans un mot de 64 bits.
+Il lit soit un bloc déjà en mémoire, soit un FILE par blocs de IO_BLOCK_SIZE */
+typedef struct
+{
+	FILE				*input;   // NULL quand les données sont en mémoire
+	const unsigned char	*data;
+	unsigned char		*buffer;  // Buffer de lecture (mode FILE uniquement)
+	size_t				pos;
+	size_t				size;
+	uint64_t			bits;     // Bits en attente, le prochain bit est le bit de poids fort
+	int					count;    // Nombre de bits valides dans bits
+}				BitReader;
+
+/* Boucles spécialisées par longueur maximale des codes (kernels.c). Elles
+traitent ce qu'elles peuvent sans test par symbole et renvoient le nombre
+de symboles traités ; la boucle générique finit le travail */
+typedef size_t	(*DecodeKernel)(BitReader *reader, const DecodeTable *table, unsigned char *dst,
+	size_t count);
+typedef size_t	(*SplitKernel)(BitReader *readers, const DecodeTable *table, unsigned char *dst,
+	size_t quarter, size_t count);
+typedef size_t	(*EncodeKernel)(BitWriter *writer, const unsigned char *data, size_t size,
+	const HuffmanCode *codes);
+
+/* Table de codes partagée, entraînée sur un corpus et chargée par les deux
+côtés : les fichiers compressés avec elle ne portent que son identifiant */
+typedef struct
+{
+	uint32_t		id;                   // Empreinte des longueurs de codes
+	uint8_t			lengths[MAX_SYMBOLS]; // Longueur du code de chaque octet (aucune nulle)
+	int				max_length;           // Longueur du plus long code
+	HuffmanTable	*codes;               // Codes canoniques de l'encodeur
+	DecodeTable		*table;               // Table du décodeur
+}				HuffDictionary;
+
+/* Réglages du décodage d'un fichier (decode_input). Les contrôles de
+structure sont toujours faits, une fois par en-tête ou par bloc ; max_output
+borne en plus la taille décodée annoncée, avant tout décodage */
+typedef struct
+{
+	const HuffDictionary	*dict;        // Table partagée des fichiers de version 4, ou NULL
+	ThreadPool				*pool;        // Décodage parallèle des blocs, NULL : thread appelant
+	uint64_t				max_output;   // Taille décodée maximale acceptée (--max-size)
+	bool					verbose;      // Messages de progression sur la sortie standard
+}				DecodeOptions;
+
+// Étapes d'un flux de décompression
+# define STREAM_SIGNATURE 0     // Signature et version
+# define STREAM_BLOCK_HEADER 1  // Taille décodée et taille compressée d'un bloc
+# define STREAM_PACKED 2        // Contenu compressé du bloc
+# define STREAM_SYMBOLS 3       // Symboles du bloc en cours de décodage
+# define STREAM_TRAILER 4       // Taille totale (version 3)
+# define STREAM_DONE 5          // Fin du flux atteinte (ou écrite, en compression)
+# define STREAM_COPY 6          // Octets d'un bloc stocké ou déjà décodé en cours de copie
+
+/* Contexte d'un flux de compression ou de décompression. Les données sont
+poussées par morceaux de taille quelconque ; l'état entre deux appels tient
+dans ce contexte. La mémoire est bornée par la taille d'un bloc */
+typedef struct
+{
+	int				mode;             // HUFF_STREAM_COMPRESS ou HUFF_STREAM_DECOMPRESS
+	int				state;            // Étape STREAM_*
+	EncodeOptions	options;
+	unsigned char	*block;           // Bloc en cours : brut (compression) ou compressé (décompression)
+	size_t			block_capacity;
+	size_t			block_size;       // Octets attendus dans block (décompression)
+	size_t			block_fill;       // Octets présents dans block
+	unsigned char	*pending;         // Sortie compressée pas encore rendue (compression)
+	size_t			pending_capacity;
+	size_t			pending_pos;
+	size_t			pending_size;
+	unsigned char	header[2 * sizeof(uint32_t)]; // En-tête en cours de lecture
+	size_t			header_fill;
+	int				version;
+	uint32_t		raw_size;         // Taille décodée du bloc courant
+	uint64_t		total;            // Octets reçus (compression) ou rendus (décompression)
+	DecodeTable		*table;           // Table du bloc en cours de décodage
+	unsigned char	*raw;             // Bloc à flux multiples décodé d'un coup
+	size_t			raw_capacity;
+	const unsigned char	*copy;        // Octets rendus par copie (STREAM_COPY)
+	DecodeTable		*contexts[MAX_SYMBOLS]; // Tables d'un bloc à contextes
+	HuffArena		arena;            // Tables du bloc en cours
+	bool			context;          // Le bloc en cours est un bloc à contextes
+	unsigned char	previous;         // Dernier octet décodé du bloc à contextes
+	BitReader		reader;           // Position du décodeur dans le bloc
+	size_t			remaining;        // Symboles du bloc encore à décoder
+	uint32_t		crc;              // CRC32C des octets déjà rendus du bloc (version 5)
+	uint32_t		expected_crc;     // CRC32C lu à la fin du bloc (version 5)
+}				HuffStream;
+
+/* Mesures d'une compression ou d'une décompression. Les durées sont
+cumulées sur tous les threads : avec -T, une phase peut dépasser le temps
+écoulé */
+typedef struct
+{
+	uint64_t	phase_ns[STAT_PHASES];  // Durée de chaque phase STAT_*, en nanosecondes
+	uint64_t	counters[STAT_COUNTERS];
+	uint32_t	max_code_length;        // Plus long code utilisé
+}				HuffStats;
+
+// Un thread du mode lot : ses buffers servent à tous les fichiers qu'il compresse
+typedef struct
+{
+	BlockJob		*job;            // Bloc en cours et son buffer de sortie
+	OutputBuffer	*output;         // Buffer d'écriture, rattaché au fichier en cours
+	unsigned char	*data;           // Contenu d'un petit fichier, lu sans projection
+	size_t			data_capacity;
+}				BatchWorker;
+
+/* Compression de nombreux fichiers dans un seul processus (compress -b). Les
+threads se partagent la liste : chacun prend le fichier suivant dès qu'il a
+fini le sien */
+typedef struct
+{
+	char					**paths;
+	size_t					count;
+	size_t					capacity;
+	size_t					next;         // Prochain fichier à prendre
+	const EncodeOptions		*options;
+	const HuffDictionary	*dict;        // Table partagée (-D), ou NULL
+	BatchWorker				*workers;
+	int						*errors;      // Par fichier : 0, errno, ou -1 si la compression a échoué
+	uint64_t				bytes_in;
+	uint64_t				bytes_out;
+	uint64_t				failed;       // Fichiers non compressés
+}				HuffBatch;
+
+// huffman.c : interface de la bibliothèque, de buffer à buffer
+HUFF_API size_t	huff_compress_bound(size_t size);
+HUFF_API int	huff_compress(const void *src, size_t src_size, void *dst, size_t *dst_size);
+HUFF_API int	huff_compress_arena(const void *src, size_t src_size, void *dst, size_t *dst_size,
+					HuffArena *arena);
+HUFF_API int	huff_decompressed_size(const void *src, size_t src_size, uint64_t *size);
+HUFF_API int	huff_decompress(const void *src, size_t src_size, void *dst, size_t *dst_size);
+HUFF_API int	huff_decompress_pool(const void *src, size_t src_size, void *dst, size_t *dst_size,
+					ThreadPool *pool);
+HUFF_API int	huff_decompress_arena(const void *src, size_t src_size, void *dst, size_t *dst_size,
+					HuffArena *arena);
+HUFF_API int	huff_decompress_range(const void *src, size_t src_size, uint64_t offset,
+					void *dst, size_t *dst_size);
+
+// stream.c : interface de la bibliothèque par flux
+HUFF_API int	huff_stream_init(HuffStream *stream, int mode);
+HUFF_API int	huff_stream_update(HuffStream *stream, const void *in, size_t *in_size, void *out, size_t *out_size);
+HUFF_API int	huff_stream_flush(HuffStream *stream, void *out, size_t *out_size);
+HUFF_API int	huff_stream_finish(HuffStream *stream, void *out, size_t *out_size);
+HUFF_API void	huff_stream_free(HuffStream *stream);
+
+// arena.c : régions de travail des blocs, sans allocation d'un bloc à l'autre
+HUFF_API int	huff_arena_init(HuffArena *arena, size_t capacity);
+void			*arena_alloc(HuffArena *arena, size_t size);
+HUFF_API void	huff_arena_reset(HuffArena *arena);
+HUFF_API void	huff_arena_free(HuffArena *arena);
+
+// stats.c : instrumentation, inactive tant que huff_stats_enable n'est pas appelée
+HUFF_API void	huff_stats_enable(HuffStats *stats);
+uint64_t		stats_start(void);
+void			stats_stop(int phase, uint64_t start);
+void			stats_count(int counter, uint64_t value);
+void			stats_code_lengths(const uint8_t *lengths);
+HUFF_API bool	print_stats(FILE *file, const HuffStats *stats, const char *mode, const char *format);
+
+// batch.c : mode lot
+bool			add_batch_path(HuffBatch *batch, const char *path);
+bool			read_batch_list(HuffBatch *batch, FILE *list);
+bool			run_batch(HuffBatch *batch, ThreadPool *pool);
+void			free_batch(HuffBatch *batch);
+
+// dictionary.c : tables partagées
+bool			train_dictionary(const uint64_t *frequencies, int max_length, HuffDictionary *dict);
+bool			save_dictionary(const HuffDictionary *dict, const char *path);
+HUFF_API bool	load_dictionary(const char *path, HuffDictionary *dict);
+HUFF_API void	free_dictionary(HuffDictionary *dict);
+HUFF_API size_t	huff_compress_dict_bound(const HuffDictionary *dict, size_t size);
+HUFF_API int	huff_compress_dict(const HuffDictionary *dict, const void *src, size_t src_size,
+					void *dst, size_t *dst_size);
+HUFF_API int	huff_decompress_dict(const HuffDictionary *dict, const void *src, size_t src_size,
+					void *dst, size_t *dst_size);
+uint32_t		dictionary_id(const uint8_t *lengths);
+bool			prepare_dictionary(HuffDictionary *dict);
+int				read_dict_header(const HuffDictionary *dict, const unsigned char *src, size_t src_size,
+					uint64_t *total);
+bool			write_dictionary_file(const HuffDictionary *dict, const unsigned char *data, size_t size,
+					OutputBuffer *output, bool *seen);
+
+// canonical.c
+void			compute_code_lengths(const HuffmanTree *tree, uint8_t *lengths);
+void			limit_code_lengths(const uint64_t *frequencies, int limit, uint8_t *lengths);
+bool			assign_canonical_codes(const uint8_t *lengths, uint64_t *codes);
+HuffmanTable	*generate_canonical_codes(const uint8_t *lengths, HuffArena *arena);
+size_t			code_lengths_size(const unsigned char *src, size_t available);
+size_t			code_lengths_min_size(int used);
+size_t			write_code_lengths(unsigned char *dst, const uint8_t *lengths);
+size_t			read_code_lengths(const unsigned char *src, size_t size, uint8_t *lengths);
+
+// io.c
+InputBuffer		*open_input(const char *path);
+InputBuffer		*open_input_fd(int fd);
+void			close_input(InputBuffer *input);
+unsigned char	*map_output(int fd, uint64_t size);
+OutputBuffer	*open_output(FILE *file);
+bool			flush_output(OutputBuffer *output);
+void			write_output(OutputBuffer *output, const void *data, size_t size);
+bool			close_output(OutputBuffer *output);
+bool			reserve_buffer(unsigned char **buffer, size_t *capacity, size_t size);
+
+// Ajoute un octet à la sortie bufferisée
+static inline void	output_byte(OutputBuffer *output, unsigned char c)
+{
+	if (output->pos == IO_BLOCK_SIZE)
+		flush_output(output);
+	output->buffer[output->pos++] = c;
+}
+
+// checksum.c
+uint32_t		crc32c_update(uint32_t crc, const void *data, size_t size);
+uint32_t		crc32c(const void *data, size_t size);
+
+// histogram.c
+void			count_histogram(const unsigned char *data, size_t size, uint64_t *counts);
+void			count_histogram_parallel(const unsigned char *data, size_t size, uint64_t *counts, ThreadPool *pool);
+
+// tree.c
+int				add_node(HuffmanTree *tree, unsigned char c, uint64_t freq, int left, int right);
+bool			build_huffman_tree(const FrequencyTable *freq_table, HuffmanTree *tree);
+void			generate_codes_recursive(const HuffmanTree *tree, int index, uint64_t current_code, size_t depth, HuffmanTable *table);
+HuffmanTable	*generate_huffman_codes(const HuffmanTree *tree);
+
+// encode.c
+void			free_huffman_table(HuffmanTable *table);
+void			free_frequency_table(FrequencyTable *table);
+FrequencyTable	*count_frequencies(const unsigned char *data, size_t size, HuffArena *arena);
+uint64_t		entropy_bits(const FrequencyTable *table);
+void			normalize_frequencies(FrequencyTable *table);
+uint64_t		coded_bits(const FrequencyTable *table, const uint8_t *lengths);
+void			choose_code_lengths(FrequencyTable *freq_table, const EncodeOptions *options, uint8_t *lengths);
+void			flush_bits(BitWriter *writer);
+void			encode_symbols(BitWriter *writer, const unsigned char *data, size_t size, const HuffmanTable *codes);
+void			encode_context_symbols(BitWriter *writer, const unsigned char *data, size_t size,
+					HuffmanTable *const *codes);
+size_t			encode_block(const unsigned char *data, size_t size, unsigned char *dst, bool *seen,
+					const EncodeOptions *options, HuffArena *arena);
+size_t			append_checksum(const unsigned char *data, size_t size, unsigned char *packed, size_t packed_size);
+BlockJob		*create_jobs(size_t batch, bool own_input, const EncodeOptions *options);
+void			free_jobs(BlockJob *jobs, size_t batch);
+bool			write_compressed_jobs(const unsigned char *data, size_t size, OutputBuffer *output, bool *seen,
+					ThreadPool *pool, BlockJob *jobs, size_t batch);
+bool			write_compressed_file(const unsigned char *data, size_t size, OutputBuffer *output, bool *seen,
+					ThreadPool *pool, const EncodeOptions *options);
+bool			write_compressed_stream(FILE *input, OutputBuffer *output, bool *seen, ThreadPool *pool,
+					const EncodeOptions *options);
+
+// context.c : blocs à contextes (ordre 1)
+size_t			encode_context_block(const unsigned char *data, size_t size, unsigned char *dst,
+					const EncodeOptions *options, size_t limit, HuffArena *arena);
+size_t			read_context_tables(const unsigned char *src, size_t size, DecodeTable **tables,
+					HuffArena *arena);
+bool			decode_context_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+					size_t raw_size, HuffArena *arena);
+
+// pool.c
+HUFF_API ThreadPool	*pool_create(int threads);
+void			pool_run(ThreadPool *pool, size_t count, void (*job)(void *, size_t), void *context);
+HUFF_API void	pool_destroy(ThreadPool *pool);
+int				resolve_thread_count(int requested);
+
+// kernels.c
+DecodeKernel	decode_kernel(const DecodeTable *table);
+SplitKernel		split_kernel(const DecodeTable *table);
+EncodeKernel	encode_kernel(int max_length);
+
+// decode.c
+bool			build_legacy_tree(const FrequencyTable *freq_table, HuffmanTree *tree);
+FrequencyTable	*read_frequency_table(FILE *input);
+FrequencyTable	*read_frequency_pairs(FILE *input, uint32_t total_symbols);
+bool			decode_file(FILE *input, FILE *output, const HuffmanTree *tree, uint64_t total_characters);
+DecodeTable		*build_decode_table(const HuffmanTree *tree);
+DecodeTable		*build_canonical_decode_table(const uint8_t *lengths, HuffArena *arena);
+bool			decode_file_table(FILE *input, OutputBuffer *output, DecodeTable *table, uint64_t total_characters);
+bool			decode_symbols(BitReader *reader, DecodeTable *table, unsigned char *dst, size_t count);
+bool			decode_context_symbols(BitReader *reader, DecodeTable *const *tables, unsigned char *previous,
+					unsigned char *dst, size_t count);
+void			init_block_reader(BitReader *reader, const unsigned char *src, size_t size);
+bool			decode_block(const unsigned char *src, size_t size, unsigned char *dst, size_t count, DecodeTable *table);
+size_t			split_segment(size_t size, int index);
+bool			decode_split_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+					size_t raw_size, HuffArena *arena);
+bool			decode_packed_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+					size_t raw_size, HuffArena *arena);
+bool			decode_checked_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+					size_t raw_size, HuffArena *arena);
+void			decode_job(void *context, size_t index);
+bool			read_canonical_header(FILE *input, uint64_t *total_characters, uint8_t *lengths);
+int				read_format_version(FILE *input, unsigned char *signature);
+bool			decode_blocks(FILE *input, OutputBuffer *output, int version, const DecodeOptions *options);
+bool			decode_format(FILE *input, OutputBuffer *output, int version, const unsigned char *signature,
+					const DecodeOptions *options);
+bool			decode_input(FILE *input, OutputBuffer *output, const DecodeOptions *options);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "../includes/huffman.h"
+
+/* Arène : toutes les tables d'un bloc (fréquences, codes, tables de décodage,
+modèle à contextes) sont prises à la suite dans une seule région, puis
+rendues d'un coup par huff_arena_reset. Une allocation qui ne tient pas dans
+la région passe par malloc et est chaînée à part ; le reset suivant agrandit
+la région au besoin du cycle écoulé. Après le premier bloc, les blocs
+suivants de même forme ne font donc plus aucun appel à l'allocateur.
+Une arène n'est utilisée que par un thread à la fois */
+
+// Taille arrondie à ARENA_ALIGN, qui garde chaque allocation alignée
+static size_t	align_size(size_t size)
+{
+	return ((size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+}
+
+/* Prépare une arène vide avec une région de capacity octets (0 : la région
+est créée au premier reset). Une arène mise à zéro est aussi valide */
+int	huff_arena_init(HuffArena *arena, size_t capacity)
+{
+	memset(arena, 0, sizeof(HuffArena));
+	if (capacity == 0)
+		return (HUFF_OK);
+	capacity = align_size(capacity);
+	arena->base = aligned_alloc(ARENA_ALIGN, capacity);
+	if (!arena->base)
+		return (HUFF_ERROR_MEMORY);
+	arena->capacity = capacity;
+	return (HUFF_OK);
+}
+
+/* Réserve size octets mis à zéro, rendus au prochain reset. Sans arène
+(NULL), l'allocation passe par calloc et se libère avec free */
+void	*arena_alloc(HuffArena *arena, size_t size)
+{
+	unsigned char	*chunk;
+	void			*ptr;
+
+	if (!arena)
+		return (calloc(1, size));
+	size = align_size(size);
+	arena->needed += size;
+	if (arena->capacity - arena->used >= size)
+	{
+		ptr = arena->base + arena->used;
+		arena->used += size;
+		memset(ptr, 0, size);
+		return (ptr);
+	}
+	// Débordement : l'en-tête d'ARENA_ALIGN octets garde le chaînage
+	chunk = aligned_alloc(ARENA_ALIGN, ARENA_ALIGN + size);
+	if (!chunk)
+		return (NULL);
+	memcpy(chunk, &arena->overflow, sizeof(void *));
+	arena->overflow = chunk;
+	memset(chunk + ARENA_ALIGN, 0, size);
+	return (chunk + ARENA_ALIGN);
+}
+
+// Libère les allocations qui ont débordé de la région
+static void	free_overflow(HuffArena *arena)
+{
+	unsigned char	*chunk, *next;
+
+	chunk = arena->overflow;
+	while (chunk)
+	{
+		memcpy(&next, chunk, sizeof(void *));
+		free(chunk);
+		chunk = next;
+	}
+	arena->overflow = NULL;
+}
+
+/* Rend tout ce qui a été réservé depuis le dernier reset. Si le cycle a
+débordé, la région est remplacée par une région assez grande pour lui : le
+pic de mémoire d'un bloc n'est alloué qu'une fois pour toute la suite */
+void	huff_arena_reset(HuffArena *arena)
+{
+	unsigned char	*grown;
+	size_t			capacity;
+
+	free_overflow(arena);
+	if (arena->needed > arena->capacity)
+	{
+		capacity = arena->needed;
+		grown = aligned_alloc(ARENA_ALIGN, capacity);
+		// Sans nouvelle région, l'ancienne reste valide et les débordements continuent
+		if (grown)
+		{
+			free(arena->base);
+			arena->base = grown;
+			arena->capacity = capacity;
+		}
+	}
+	arena->used = 0;
+	arena->needed = 0;
+}
+
+void	huff_arena_free(HuffArena *arena)
+{
+	free_overflow(arena);
+	free(arena->base);
+	memset(arena, 0, sizeof(HuffArena));
+}
@@ -0,0 +1,261 @@
+#include "../includes/huffman.h"
+
+/* Mode lot : de nombreux fichiers compressés dans un seul processus, chacun
+vers <fichier>.huff. Chaque thread garde ses buffers (bloc de sortie,
+écriture, lecture des petits fichiers) d'un fichier à l'autre : un petit
+fichier ne coûte qu'une ouverture, une lecture et une écriture */
+
+// Ajoute un chemin à la liste, sans le vérifier
+static bool	push_path(HuffBatch *batch, const char *path)
+{
+	char	**grown;
+
+	if (batch->count == batch->capacity)
+	{
+		grown = realloc(batch->paths, (batch->capacity * 2 + 64) * sizeof(char *));
+		if (!grown)
+			return (false);
+		batch->paths = grown;
+		batch->capacity = batch->capacity * 2 + 64;
+	}
+	batch->paths[batch->count] = strdup(path);
+	if (!batch->paths[batch->count])
+		return (false);
+	batch->count++;
+	return (true);
+}
+
+static bool	is_compressed_name(const char *path)
+{
+	size_t	len;
+
+	len = strlen(path);
+	return (len >= 5 && strcmp(path + len - 5, ".huff") == 0);
+}
+
+/* Parcours récursif d'un répertoire. Les liens symboliques vers un fichier
+sont suivis, pas ceux vers un répertoire : le parcours ne peut pas boucler */
+static bool	walk_directory(HuffBatch *batch, const char *path)
+{
+	struct dirent	*entry;
+	struct stat		info;
+	DIR				*dir;
+	char			*child;
+	bool			ok;
+
+	dir = opendir(path);
+	if (!dir)
+		return (false);
+	ok = true;
+	while (ok && (entry = readdir(dir)))
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		child = malloc(strlen(path) + strlen(entry->d_name) + 2);
+		if (!child)
+			ok = false;
+		else
+		{
+			sprintf(child, "%s/%s", path, entry->d_name);
+			ok = lstat(child, &info) == 0;
+			if (ok && S_ISDIR(info.st_mode))
+				ok = walk_directory(batch, child);
+			else if (ok && (!S_ISLNK(info.st_mode) || stat(child, &info) == 0)
+				&& S_ISREG(info.st_mode) && !is_compressed_name(child))
+				ok = push_path(batch, child);
+			free(child);
+		}
+	}
+	closedir(dir);
+	return (ok);
+}
+
+/* Ajoute un fichier, ou tous les fichiers ordinaires d'un répertoire et de
+ses sous-répertoires. Les fichiers .huff trouvés dans un répertoire sont
+ignorés : relancer le lot ne recompresse pas sa propre sortie. Renvoie
+false si path ou l'un de ses sous-répertoires est illisible */
+bool	add_batch_path(HuffBatch *batch, const char *path)
+{
+	struct stat	info;
+
+	if (stat(path, &info) != 0)
+		return (false);
+	if (S_ISDIR(info.st_mode))
+		return (walk_directory(batch, path));
+	return (push_path(batch, path));
+}
+
+/* Liste de fichiers, un chemin par ligne (sortie de find par exemple). Les
+lignes vides sont ignorées ; les chemins ne sont vérifiés qu'à la
+compression, un fichier absent compte donc comme un échec du lot */
+bool	read_batch_list(HuffBatch *batch, FILE *list)
+{
+	char	*line;
+	size_t	capacity;
+	ssize_t	len;
+	bool	ok;
+
+	line = NULL;
+	capacity = 0;
+	ok = true;
+	while (ok && (len = getline(&line, &capacity, list)) >= 0)
+	{
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+		if (len > 0)
+			ok = push_path(batch, line);
+	}
+	free(line);
+	return (ok && !ferror(list));
+}
+
+/* Charge un fichier. Jusqu'à HUFF_BLOCK_SIZE octets, il est lu d'un coup
+dans le buffer du thread, sans projection ni allocation ; au-delà, il est
+projeté en mémoire (*mapped, à fermer). Renvoie NULL en cas d'erreur */
+static const unsigned char	*load_file(BatchWorker *worker, const char *path, size_t *size,
+	InputBuffer **mapped)
+{
+	struct stat	info;
+	ssize_t		got;
+	uint64_t	start;
+	int			fd;
+
+	*mapped = NULL;
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return (NULL);
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size > HUFF_BLOCK_SIZE)
+	{
+		*mapped = open_input_fd(fd);
+		close(fd);
+		*size = *mapped ? (*mapped)->size : 0;
+		return (*mapped ? (*mapped)->data : NULL);
+	}
+	got = 0;
+	*size = 0;
+	if (reserve_buffer(&worker->data, &worker->data_capacity, info.st_size + 1))
+	{
+		start = stats_start();
+		while (*size < (size_t)info.st_size
+			&& (got = read(fd, worker->data + *size, info.st_size - *size)) > 0)
+			*size += got;
+		stats_stop(STAT_READ, start);
+		stats_count(STAT_READ_CALLS, 1);
+		stats_count(STAT_BYTES_IN, *size);
+	}
+	close(fd);
+	return (got >= 0 && *size == (size_t)info.st_size ? worker->data : NULL);
+}
+
+/* Compresse un fichier vers <path>.huff avec les buffers du thread. Renvoie
+0, errno si un fichier n'a pas pu être ouvert, -1 si la compression a
+échoué. Une sortie incomplète est supprimée */
+static int	compress_one(HuffBatch *batch, BatchWorker *worker, const char *path)
+{
+	const unsigned char	*data;
+	InputBuffer			*mapped;
+	char				*name;
+	bool				seen[MAX_SYMBOLS] = {false};
+	size_t				size;
+	off_t				packed;
+	bool				ok;
+	int					error;
+
+	name = malloc(strlen(path) + 6);
+	if (!name)
+		return (ENOMEM);
+	sprintf(name, "%s.huff", path);
+	data = load_file(worker, path, &size, &mapped);
+	worker->output->file = data ? fopen(name, "wb") : NULL;
+	if (!worker->output->file)
+	{
+		error = errno ? errno : EIO;
+		close_input(mapped);
+		free(name);
+		return (error);
+	}
+	worker->output->pos = 0;
+	worker->output->error = false;
+	if (batch->dict)
+		ok = write_dictionary_file(batch->dict, data, size, worker->output, seen);
+	else
+		ok = write_compressed_jobs(data, size, worker->output, seen, NULL, worker->job, 1);
+	ok = flush_output(worker->output) && ok;
+	packed = ftello(worker->output->file);
+	ok = fclose(worker->output->file) == 0 && ok;
+	close_input(mapped);
+	if (ok)
+	{
+		__atomic_fetch_add(&batch->bytes_in, size, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&batch->bytes_out, packed, __ATOMIC_RELAXED);
+	}
+	else
+		unlink(name);
+	free(name);
+	return (ok ? 0 : -1);
+}
+
+/* Tâche d'un thread : prend les fichiers un par un dans la liste partagée
+jusqu'à l'épuiser. Les gros fichiers n'immobilisent que leur thread */
+static void	batch_job(void *context, size_t index)
+{
+	HuffBatch	*batch;
+	size_t		next;
+
+	batch = context;
+	while ((next = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->count)
+	{
+		errno = 0;
+		batch->errors[next] = compress_one(batch, &batch->workers[index], batch->paths[next]);
+		if (batch->errors[next] != 0)
+			__atomic_fetch_add(&batch->failed, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static void	free_workers(BatchWorker *workers, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (workers[i].job)
+			free_jobs(workers[i].job, 1);
+		close_output(workers[i].output);
+		free(workers[i].data);
+	}
+	free(workers);
+}
+
+/* Compresse tous les fichiers de la liste, un fichier par thread à la fois.
+Le résultat de chaque fichier est rangé dans batch->errors. Renvoie false
+si les buffers des threads n'ont pas pu être alloués */
+bool	run_batch(HuffBatch *batch, ThreadPool *pool)
+{
+	int		threads;
+	bool	ok;
+
+	threads = pool ? pool->thread_count : 1;
+	batch->workers = calloc(threads, sizeof(BatchWorker));
+	batch->errors = calloc(batch->count + 1, sizeof(int));
+	ok = batch->workers && batch->errors;
+	for (int i = 0; ok && i < threads; i++)
+	{
+		batch->workers[i].job = create_jobs(1, false, batch->options);
+		batch->workers[i].output = open_output(NULL);
+		ok = batch->workers[i].job && batch->workers[i].output;
+	}
+	batch->next = 0;
+	if (ok)
+		pool_run(pool, threads, batch_job, batch);
+	if (batch->workers)
+		free_workers(batch->workers, threads);
+	batch->workers = NULL;
+	return (ok);
+}
+
+void	free_batch(HuffBatch *batch)
+{
+	for (size_t i = 0; i < batch->count; i++)
+		free(batch->paths[i]);
+	free(batch->paths);
+	free(batch->errors);
+	memset(batch, 0, sizeof(HuffBatch));
+}
@@ -0,0 +1,230 @@
+#include "../includes/huffman.h"
+
+// Nombre de décodages mesurés par décodeur (le meilleur temps est retenu)
+#define BENCH_ITERATIONS 5
+
+static double	now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/* Arbre de référence pour le format canonique : chaque code est inséré bit par
+bit, ce qui permet de comparer le parcours d'arbre au décodeur par table */
+static bool	build_tree_from_lengths(const uint8_t *lengths, HuffmanTree *tree)
+{
+	uint64_t	codes[MAX_SYMBOLS];
+	int16_t		*next;
+	int			node;
+
+	if (!assign_canonical_codes(lengths, codes))
+		return (false);
+	tree->count = 0;
+	tree->root = add_node(tree, 0, 0, -1, -1);
+	tree->nodes[tree->root].is_leaf = false;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (!lengths[i])
+			continue;
+		node = tree->root;
+		for (int bit = lengths[i] - 1; bit >= 0; bit--)
+		{
+			next = ((codes[i] >> bit) & 1) ? &tree->nodes[node].right : &tree->nodes[node].left;
+			if (*next < 0)
+			{
+				*next = add_node(tree, i, 0, -1, -1);
+				if (*next < 0)
+					return (false);
+				tree->nodes[*next].is_leaf = (bit == 0);
+			}
+			node = *next;
+		}
+	}
+	return (true);
+}
+
+// Parcours de l'arbre sur un flux codé de size octets, vers count symboles
+static bool	tree_decode_stream(const HuffmanTree *tree, const unsigned char *src, size_t size,
+	unsigned char *dst, size_t count)
+{
+	FILE	*input, *output;
+	bool	ok;
+
+	if (count == 0)
+		return (true);
+	input = fmemopen((void *)src, size, "rb");
+	output = fmemopen(dst, count + 1, "wb");
+	ok = input && output && decode_file(input, output, tree, count);
+	if (input)
+		fclose(input);
+	if (output)
+		fclose(output);
+	return (ok);
+}
+
+/* Bloc à flux multiples par l'arbre : même disposition que
+decode_split_block (marque, longueurs, tailles des premiers flux, flux),
+chaque flux parcouru à son tour vers son segment du bloc */
+static bool	tree_decode_split(const unsigned char *body, uint32_t body_size, unsigned char *dst,
+	uint32_t count)
+{
+	uint8_t		lengths[MAX_SYMBOLS];
+	uint32_t	sizes[SPLIT_STREAMS - 1];
+	HuffmanTree	tree;
+	size_t		pos, used, stream, offset;
+
+	used = read_code_lengths(body + 1, body_size - 1, lengths);
+	pos = 1 + used;
+	if (used == 0 || body_size - pos < sizeof(sizes) || !build_tree_from_lengths(lengths, &tree))
+		return (false);
+	memcpy(sizes, body + pos, sizeof(sizes));
+	pos += sizeof(sizes);
+	offset = 0;
+	for (int k = 0; k < SPLIT_STREAMS; k++)
+	{
+		// Le dernier flux va jusqu'à la fin du bloc
+		stream = k < SPLIT_STREAMS - 1 ? sizes[k] : body_size - pos;
+		if (stream > body_size - pos
+			|| !tree_decode_stream(&tree, body + pos, stream, dst + offset, split_segment(count, k)))
+			return (false);
+		pos += stream;
+		offset += split_segment(count, k);
+	}
+	return (true);
+}
+
+/* Décode un bloc avec le décodeur choisi : parcours de l'arbre bit par bit ou
+table, prise dans arena. La construction de l'arbre ou de la table fait
+partie de la mesure */
+static bool	decode_one_block(bool use_table, const unsigned char *body, uint32_t body_size,
+	unsigned char *dst, uint32_t count, HuffArena *arena)
+{
+	uint8_t		lengths[MAX_SYMBOLS];
+	size_t		used;
+	HuffmanTree	tree;
+
+	// Bloc stocké : simple copie, quel que soit le décodeur
+	if (body_size == count + 1 && body[0] == STORED_BLOCK)
+	{
+		memcpy(dst, body + 1, count);
+		return (true);
+	}
+	// Blocs à contextes : une table par octet précédent, seul le décodeur par table les gère
+	if (body_size > 0 && body[0] == CONTEXT_BLOCK)
+		return (decode_context_block(body, body_size, dst, count, arena));
+	// Flux multiples : l'arbre parcourt les flux l'un après l'autre
+	if (body_size > 0 && body[0] == SPLIT_BLOCK)
+		return (use_table ? decode_split_block(body, body_size, dst, count, arena)
+			: tree_decode_split(body, body_size, dst, count));
+	used = read_code_lengths(body, body_size, lengths);
+	if (used == 0)
+		return (false);
+	if (use_table)
+		return (decode_block(body + used, body_size - used, dst, count,
+				build_canonical_decode_table(lengths, arena)));
+	if (!build_tree_from_lengths(lengths, &tree))
+		return (false);
+	return (tree_decode_stream(&tree, body + used, body_size - used, dst, count));
+}
+
+/* Décode tous les blocs du fichier BENCH_ITERATIONS fois et renvoie le
+meilleur temps ; le résultat décodé reste dans out */
+static double	bench_decoder(bool use_table, const unsigned char *data, size_t size, unsigned char *out)
+{
+	HuffArena	arena;
+	size_t		checksum;
+	uint32_t	header[2];
+	size_t		pos, written;
+	double		best, start, elapsed;
+
+	huff_arena_init(&arena, 0);
+	// Le CRC32C de fin de bloc (version 5) n'est pas vérifié : seuls les décodeurs sont comparés
+	checksum = data[3] == HUFF_VERSION_CHECKED ? CHECKSUM_SIZE : 0;
+	best = -1;
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		start = now();
+		pos = 4;
+		written = 0;
+		while (pos + sizeof(header) <= size)
+		{
+			memcpy(header, data + pos, sizeof(header));
+			pos += sizeof(header);
+			if (header[0] == 0)
+				break;
+			huff_arena_reset(&arena);
+			if (header[1] < checksum || !decode_one_block(use_table, data + pos, header[1] - checksum,
+					out + written, header[0], &arena))
+				fprintf(stderr, "Erreur de décodage\n");
+			pos += header[1];
+			written += header[0];
+		}
+		elapsed = now() - start;
+		if (best < 0 || elapsed < best)
+			best = elapsed;
+	}
+	huff_arena_free(&arena);
+	return (best);
+}
+
+// Taille décodée totale : somme des tailles de blocs
+static size_t	decoded_size(const unsigned char *data, size_t size)
+{
+	uint32_t	header[2];
+	size_t		pos, total;
+
+	total = 0;
+	for (pos = 4; pos + sizeof(header) <= size; pos += header[1])
+	{
+		memcpy(header, data + pos, sizeof(header));
+		pos += sizeof(header);
+		if (header[0] == 0)
+			break;
+		total += header[0];
+	}
+	return (total);
+}
+
+int	main(int argc, char **argv)
+{
+	InputBuffer		*input;
+	unsigned char	*tree_out, *table_out;
+	size_t			total;
+	double			tree_time, table_time;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <fichier.huff>...\n", argv[0]);
+		return (1);
+	}
+	printf("%-32s %12s %12s %10s\n", "fichier", "arbre MB/s", "table MB/s", "gain");
+	for (int i = 1; i < argc; i++)
+	{
+		input = open_input(argv[i]);
+		if (!input || input->size < 4 || memcmp(input->data, HUFF_MAGIC, 3) != 0
+			|| (input->data[3] != HUFF_VERSION_BLOCKS && input->data[3] != HUFF_VERSION_LARGE
+				&& input->data[3] != HUFF_VERSION_CHECKED))
+		{
+			fprintf(stderr, "%s: fichier absent ou d'une ancienne version\n", argv[i]);
+			return (1);
+		}
+		total = decoded_size(input->data, input->size);
+		tree_out = calloc(total + 1, 1);
+		table_out = calloc(total + 1, 1);
+		tree_time = bench_decoder(false, input->data, input->size, tree_out);
+		table_time = bench_decoder(true, input->data, input->size, table_out);
+		if (memcmp(tree_out, table_out, total) != 0)
+		{
+			fprintf(stderr, "%s: les deux décodeurs divergent\n", argv[i]);
+			return (1);
+		}
+		printf("%-32s %12.1f %12.1f %9.2fx\n", argv[i], total / tree_time / 1e6,
+			total / table_time / 1e6, tree_time / table_time);
+		free(tree_out);
+		free(table_out);
+		close_input(input);
+	}
+	return (0);
+}
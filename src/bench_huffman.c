@@ -0,0 +1,337 @@
+#include "../includes/huffman.h"
+
+// Réglages par défaut : appels mesurés et appels de chauffe non comptés
+#define BENCH_ITERATIONS 20
+#define BENCH_WARMUP 3
+
+// Phases mesurées bloc par bloc, dans l'ordre du rapport
+#define PHASE_HISTOGRAM 0
+#define PHASE_TREE 1
+#define PHASE_CODES 2
+#define PHASE_ENCODE 3
+#define PHASE_DECODE 4
+#define PHASE_COUNT 5
+
+static const char	*g_phase_names[PHASE_COUNT] = {"histogram", "tree", "codes", "encode", "decode"};
+
+static double	now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+static int	compare_times(const void *a, const void *b)
+{
+	double	x = *(const double *)a;
+	double	y = *(const double *)b;
+
+	return ((x > y) - (x < y));
+}
+
+// Centile p (entre 0 et 1) des durées, triées sur place
+static double	percentile(double *times, int count, double p)
+{
+	int	index;
+
+	qsort(times, count, sizeof(double), compare_times);
+	index = (int)(p * count + 0.999999) - 1;
+	if (index < 0)
+		index = 0;
+	return (times[index]);
+}
+
+static double	mean(const double *times, int count)
+{
+	double	sum;
+
+	sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += times[i];
+	return (sum / count);
+}
+
+/* Refait la compression bloc par bloc avec les fonctions de l'encodeur, en
+chronométrant chaque phase, puis décode et contrôle chaque bloc de packed
+(version 5). Les durées s'ajoutent à phases */
+static bool	time_phases(const unsigned char *data, size_t size, const unsigned char *packed,
+	size_t packed_size, unsigned char *scratch, double *phases)
+{
+	EncodeOptions	options;
+	FrequencyTable	freq_table;
+	HuffmanTable	*codes;
+	HuffArena		arena;
+	uint64_t		counts[MAX_SYMBOLS];
+	uint8_t			lengths[MAX_SYMBOLS];
+	uint32_t		header[2];
+	BitWriter		writer;
+	size_t			chunk, pos;
+	double			start;
+	bool			ok;
+
+	options.max_code_length = DEFAULT_CODE_LENGTH_LIMIT;
+	options.context_order = 0;
+	options.write_index = false;
+	huff_arena_init(&arena, 0);
+	ok = true;
+	for (size_t offset = 0; ok && offset < size; offset += chunk)
+	{
+		chunk = size - offset < HUFF_BLOCK_SIZE ? size - offset : HUFF_BLOCK_SIZE;
+		memset(counts, 0, sizeof(counts));
+		start = now();
+		count_histogram(data + offset, chunk, counts);
+		phases[PHASE_HISTOGRAM] += now() - start;
+		freq_table.frequencies = counts;
+		freq_table.total_symbols = 0;
+		freq_table.total_characters = chunk;
+		start = now();
+		choose_code_lengths(&freq_table, &options, lengths);
+		phases[PHASE_TREE] += now() - start;
+		huff_arena_reset(&arena);
+		start = now();
+		codes = generate_canonical_codes(lengths, &arena);
+		phases[PHASE_CODES] += now() - start;
+		ok = codes != NULL;
+		if (!ok)
+			break;
+		writer.dst = scratch;
+		writer.pos = 0;
+		writer.bits = 0;
+		writer.count = 0;
+		start = now();
+		encode_symbols(&writer, data + offset, chunk, codes);
+		flush_bits(&writer);
+		phases[PHASE_ENCODE] += now() - start;
+	}
+	for (pos = 4; ok && pos + sizeof(header) <= packed_size; pos += header[1])
+	{
+		memcpy(header, packed + pos, sizeof(header));
+		pos += sizeof(header);
+		if (header[0] == 0)
+			break;
+		huff_arena_reset(&arena);
+		start = now();
+		ok = decode_checked_block(packed + pos, header[1], scratch, header[0], &arena);
+		phases[PHASE_DECODE] += now() - start;
+	}
+	huff_arena_free(&arena);
+	return (ok);
+}
+
+// Écrit une chaîne JSON entre guillemets
+static void	print_json_string(const char *s)
+{
+	putchar('"');
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			printf("\\%c", *s);
+		else if ((unsigned char)*s < 32)
+			printf("\\u%04x", *s);
+		else
+			putchar(*s);
+	}
+	putchar('"');
+}
+
+// Débit, latences médiane et p99 d'un appel (durées en secondes, triées ici)
+static void	print_calls(const char *name, double *times, int count, size_t size)
+{
+	double	average;
+
+	average = mean(times, count);
+	printf("      \"%s\": {\"mb_per_s\": %.2f, \"p50_ms\": %.4f, \"p99_ms\": %.4f}", name,
+		average > 0 ? size / average / 1e6 : 0, percentile(times, count, 0.5) * 1e3,
+		percentile(times, count, 0.99) * 1e3);
+}
+
+/* Mesure un fichier : appels de chauffe, puis iterations compressions et
+décompressions en mémoire chronométrées une à une, et une passe par phase
+à chaque itération. Ajoute les temps moyens aux totaux */
+static bool	bench_file(const char *path, int iterations, int warmup, bool first, double *totals)
+{
+	InputBuffer		*input;
+	unsigned char	*packed, *out, *scratch;
+	size_t			capacity, packed_size, out_size;
+	double			*compress_times, *decompress_times, phases[PHASE_COUNT] = {0}, start;
+	bool			ok;
+
+	input = open_input(path);
+	if (!input)
+	{
+		perror(path);
+		return (false);
+	}
+	capacity = huff_compress_bound(input->size);
+	packed = malloc(capacity);
+	out = malloc(input->size + 1);
+	scratch = malloc(HUFF_BLOCK_SIZE / 8 * DEFAULT_CODE_LENGTH_LIMIT + sizeof(uint64_t));
+	compress_times = malloc(iterations * sizeof(double));
+	decompress_times = malloc(iterations * sizeof(double));
+	ok = packed && out && scratch && compress_times && decompress_times;
+	for (int i = -warmup; ok && i < iterations; i++)
+	{
+		packed_size = capacity;
+		start = now();
+		ok = huff_compress(input->data, input->size, packed, &packed_size) == HUFF_OK;
+		if (i >= 0)
+			compress_times[i] = now() - start;
+		out_size = input->size;
+		start = now();
+		ok = ok && huff_decompress(packed, packed_size, out, &out_size) == HUFF_OK;
+		if (i >= 0)
+			decompress_times[i] = now() - start;
+		ok = ok && out_size == input->size && memcmp(out, input->data, out_size) == 0;
+		if (ok && i >= 0)
+			ok = time_phases(input->data, input->size, packed, packed_size, scratch, phases);
+	}
+	if (ok)
+	{
+		totals[0] += input->size;
+		totals[1] += packed_size;
+		totals[2] += mean(compress_times, iterations);
+		totals[3] += mean(decompress_times, iterations);
+		printf("%s    {\n      \"file\": ", first ? "" : ",\n");
+		print_json_string(path);
+		printf(",\n      \"size\": %zu,\n      \"compressed\": %zu,\n      \"ratio\": %.4f,\n",
+			input->size, packed_size, packed_size ? (double)input->size / packed_size : 0);
+		print_calls("compress", compress_times, iterations, input->size);
+		printf(",\n");
+		print_calls("decompress", decompress_times, iterations, input->size);
+		printf(",\n      \"phases_ms\": {");
+		for (int p = 0; p < PHASE_COUNT; p++)
+			printf("%s\"%s\": %.4f", p ? ", " : "", g_phase_names[p], phases[p] / iterations * 1e3);
+		printf("}\n    }");
+	}
+	else
+		fprintf(stderr, "%s : échec de la compression ou de l'aller-retour\n", path);
+	free(packed);
+	free(out);
+	free(scratch);
+	free(compress_times);
+	free(decompress_times);
+	close_input(input);
+	return (ok);
+}
+
+static int	compare_names(const void *a, const void *b)
+{
+	return (strcmp(*(char *const *)a, *(char *const *)b));
+}
+
+/* Liste des fichiers à mesurer : un chemin de fichier est gardé tel quel,
+un répertoire donne ses fichiers ordinaires par ordre alphabétique */
+static char	**collect_files(char **paths, int count, int *found)
+{
+	char			**files, **grown, *name;
+	struct stat		info;
+	struct dirent	*entry;
+	DIR				*dir;
+	int				capacity, first;
+
+	files = NULL;
+	capacity = 0;
+	*found = 0;
+	for (int i = 0; i < count; i++)
+	{
+		dir = stat(paths[i], &info) == 0 && S_ISDIR(info.st_mode) ? opendir(paths[i]) : NULL;
+		first = *found;
+		while (true)
+		{
+			name = NULL;
+			if (!dir && *found == first)
+				name = strdup(paths[i]);
+			else if (dir && (entry = readdir(dir)))
+			{
+				if (entry->d_name[0] == '.')
+					continue;
+				name = malloc(strlen(paths[i]) + strlen(entry->d_name) + 2);
+				if (name)
+					sprintf(name, "%s/%s", paths[i], entry->d_name);
+				if (name && (stat(name, &info) != 0 || !S_ISREG(info.st_mode)))
+				{
+					free(name);
+					continue;
+				}
+			}
+			if (!name)
+				break;
+			if (*found == capacity)
+			{
+				capacity = capacity * 2 + 16;
+				grown = realloc(files, capacity * sizeof(char *));
+				if (!grown)
+				{
+					free(name);
+					break;
+				}
+				files = grown;
+			}
+			files[(*found)++] = name;
+		}
+		if (dir)
+		{
+			closedir(dir);
+			qsort(files + first, *found - first, sizeof(char *), compare_names);
+		}
+	}
+	return (files);
+}
+
+static void	usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n iterations] [-w chauffe] [fichier|répertoire]...\n", name);
+	fprintf(stderr, "  -n iterations  appels mesurés par fichier (défaut %d)\n", BENCH_ITERATIONS);
+	fprintf(stderr, "  -w chauffe     appels de chauffe non mesurés (défaut %d)\n", BENCH_WARMUP);
+	fprintf(stderr, "Sans chemin, mesure les fichiers de tests/. Le rapport JSON est écrit sur la sortie standard\n");
+}
+
+/* Compression et décompression en mémoire (huff_compress, huff_decompress),
+sans fichier ni thread : seul le code du codec est mesuré */
+int	main(int argc, char **argv)
+{
+	char	*default_path[] = {"tests"};
+	char	**files;
+	int		opt, iterations, warmup, count;
+	double	totals[4] = {0};
+	bool	ok;
+
+	iterations = BENCH_ITERATIONS;
+	warmup = BENCH_WARMUP;
+	while ((opt = getopt(argc, argv, "n:w:")) != -1)
+	{
+		if (opt == 'n' && atoi(optarg) > 0)
+			iterations = atoi(optarg);
+		else if (opt == 'w' && atoi(optarg) >= 0)
+			warmup = atoi(optarg);
+		else
+		{
+			usage(argv[0]);
+			return (1);
+		}
+	}
+	if (optind < argc)
+		files = collect_files(argv + optind, argc - optind, &count);
+	else
+		files = collect_files(default_path, 1, &count);
+	if (count == 0)
+	{
+		fprintf(stderr, "Aucun fichier à mesurer\n");
+		return (1);
+	}
+	printf("{\n  \"iterations\": %d,\n  \"warmup\": %d,\n  \"block_size\": %d,\n  \"files\": [\n",
+		iterations, warmup, HUFF_BLOCK_SIZE);
+	ok = true;
+	for (int i = 0; i < count; i++)
+	{
+		ok = bench_file(files[i], iterations, warmup, i == 0, totals) && ok;
+		free(files[i]);
+	}
+	free(files);
+	printf("\n  ],\n  \"total\": {\"size\": %.0f, \"compressed\": %.0f, \"ratio\": %.4f, "
+		"\"compress_mb_per_s\": %.2f, \"decompress_mb_per_s\": %.2f}\n}\n",
+		totals[0], totals[1], totals[1] > 0 ? totals[0] / totals[1] : 0,
+		totals[2] > 0 ? totals[0] / totals[2] / 1e6 : 0, totals[3] > 0 ? totals[0] / totals[3] / 1e6 : 0);
+	return (ok ? 0 : 1);
+}
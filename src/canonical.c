@@ -0,0 +1,339 @@
+#include "../includes/huffman.h"
+
+// Relève la profondeur de chaque feuille de l'arbre
+static void	collect_lengths(const HuffmanTree *tree, int index, int depth, uint8_t *lengths)
+{
+	const HuffmanNode	*node;
+
+	if (index < 0)
+		return;
+	node = &tree->nodes[index];
+	if (node->is_leaf)
+	{
+		lengths[node->character] = depth;
+		return;
+	}
+	collect_lengths(tree, node->left, depth + 1, lengths);
+	collect_lengths(tree, node->right, depth + 1, lengths);
+}
+
+/* Calcule la longueur du code de chaque symbole à partir de l'arbre.
+Un symbole seul reçoit un code d'un bit pour rester décodable */
+void	compute_code_lengths(const HuffmanTree *tree, uint8_t *lengths)
+{
+	memset(lengths, 0, MAX_SYMBOLS);
+	if (tree->root < 0)
+		return;
+	if (tree->nodes[tree->root].is_leaf)
+	{
+		lengths[tree->nodes[tree->root].character] = 1;
+		return;
+	}
+	collect_lengths(tree, tree->root, 0, lengths);
+}
+
+// Trie les symboles présents par fréquence croissante (puis par valeur)
+static int	sort_by_frequency(const uint64_t *frequencies, uint8_t *order)
+{
+	int		n, j;
+	uint8_t	symbol;
+
+	n = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (!frequencies[i])
+			continue;
+		symbol = i;
+		for (j = n; j > 0 && frequencies[order[j - 1]] > frequencies[symbol]; j--)
+			order[j] = order[j - 1];
+		order[j] = symbol;
+		n++;
+	}
+	return (n);
+}
+
+/* Longueurs optimales bornées par limit (algorithme package-merge).
+Au niveau le plus profond, la liste ne contient que les feuilles triées ;
+à chaque niveau au-dessus, les éléments de la liste précédente sont groupés
+deux par deux en paquets, fusionnés avec les feuilles par poids croissant.
+Les 2n - 2 premiers éléments de la liste du haut sont retenus : en
+redescendant, chaque feuille retenue à un niveau allonge son code d'un bit
+et chaque paquet retenu fait retenir deux éléments du niveau inférieur.
+limit est relevée si elle est trop petite pour le nombre de symboles */
+void	limit_code_lengths(const uint64_t *frequencies, int limit, uint8_t *lengths)
+{
+	uint8_t		order[MAX_SYMBOLS];
+	uint64_t	weights[2][2 * MAX_SYMBOLS];
+	bool		packaged[MAX_CODE_LENGTH][2 * MAX_SYMBOLS];
+	int			size[MAX_CODE_LENGTH];
+	int			n, keep, leaf, pair, taken, packages;
+	uint64_t	*prev, *cur, package;
+
+	memset(lengths, 0, MAX_SYMBOLS);
+	n = sort_by_frequency(frequencies, order);
+	if (n <= 2)
+	{
+		for (int i = 0; i < n; i++)
+			lengths[order[i]] = 1;
+		return;
+	}
+	// Il faut au moins log2(n) bits ; aucun code ne dépasse n - 1 bits
+	while (limit < 8 && (1 << limit) < n)
+		limit++;
+	if (limit > MAX_CODE_LENGTH)
+		limit = MAX_CODE_LENGTH;
+	if (limit > n - 1)
+		limit = n - 1;
+	// Seuls les 2n - 2 premiers éléments d'une liste peuvent être retenus
+	keep = 2 * n - 2;
+	for (int level = 0; level < limit; level++)
+	{
+		prev = weights[(level + 1) % 2];
+		cur = weights[level % 2];
+		leaf = 0;
+		pair = 0;
+		size[level] = 0;
+		while (size[level] < keep)
+		{
+			bool has_pair = level > 0 && pair + 1 < size[level - 1];
+			package = has_pair ? prev[pair] + prev[pair + 1] : 0;
+			if (leaf < n && (!has_pair || frequencies[order[leaf]] <= package))
+			{
+				cur[size[level]] = frequencies[order[leaf++]];
+				packaged[level][size[level]++] = false;
+			}
+			else if (has_pair)
+			{
+				cur[size[level]] = package;
+				packaged[level][size[level]++] = true;
+				pair += 2;
+			}
+			else
+				break;
+		}
+	}
+	taken = keep;
+	for (int level = limit - 1; level >= 0 && taken > 0; level--)
+	{
+		packages = 0;
+		for (int i = 0; i < taken; i++)
+			packages += packaged[level][i];
+		for (int i = 0; i < taken - packages; i++)
+			lengths[order[i]]++;
+		taken = 2 * packages;
+	}
+}
+
+/* Attribue les codes canoniques : les symboles sont triés par longueur puis par
+valeur, et chaque code est le précédent plus un, décalé quand la longueur change.
+Renvoie false si les longueurs ne décrivent pas un code préfixe valide */
+bool	assign_canonical_codes(const uint8_t *lengths, uint64_t *codes)
+{
+	uint32_t	count[MAX_CODE_LENGTH + 1] = {0};
+	uint64_t	next_code[MAX_CODE_LENGTH + 1];
+	uint64_t	code;
+	int64_t		left;
+
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (lengths[i] > MAX_CODE_LENGTH)
+			return (false);
+		count[lengths[i]]++;
+	}
+	// Vérifier l'inégalité de Kraft sans dépasser 64 bits
+	left = 1;
+	for (int len = 1; len <= MAX_CODE_LENGTH; len++)
+	{
+		left = (left << 1) - count[len];
+		if (left < 0)
+			return (false);
+		if (left > MAX_SYMBOLS)
+			left = MAX_SYMBOLS + 1;
+	}
+	code = 0;
+	count[0] = 0;
+	for (int len = 1; len <= MAX_CODE_LENGTH; len++)
+	{
+		code = (code + count[len - 1]) << 1;
+		next_code[len] = code;
+	}
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		codes[i] = 0;
+		if (lengths[i])
+			codes[i] = next_code[lengths[i]]++;
+	}
+	return (true);
+}
+
+/* Construit la table de codes de l'encodeur à partir des longueurs, dans
+arena (NULL : sur le tas, libérée par free_huffman_table) */
+HuffmanTable	*generate_canonical_codes(const uint8_t *lengths, HuffArena *arena)
+{
+	HuffmanTable	*table;
+	uint64_t		codes[MAX_SYMBOLS];
+
+	if (!assign_canonical_codes(lengths, codes))
+		return (NULL);
+	table = arena_alloc(arena, sizeof(HuffmanTable));
+	if (!table)
+		return (NULL);
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (!lengths[i])
+			continue;
+		table->codes[i].code = codes[i];
+		table->codes[i].length = lengths[i];
+		table->used[i] = true;
+		if (lengths[i] > table->max_length)
+			table->max_length = lengths[i];
+	}
+	return (table);
+}
+
+// Nombre de bits nécessaires pour écrire une longueur de code
+static int	length_width(int max_length)
+{
+	int	width;
+
+	width = 1;
+	while ((1 << width) <= max_length)
+		width++;
+	return (width);
+}
+
+// Écrit value sur width bits, poids fort en premier
+static void	put_bits(unsigned char *dst, size_t *bit_pos, uint32_t value, int width)
+{
+	for (int i = width - 1; i >= 0; i--)
+	{
+		if ((value >> i) & 1)
+			dst[*bit_pos / 8] |= 1 << (7 - *bit_pos % 8);
+		(*bit_pos)++;
+	}
+}
+
+static uint32_t	get_bits(const unsigned char *src, size_t *bit_pos, int width)
+{
+	uint32_t	value;
+
+	value = 0;
+	for (int i = 0; i < width; i++)
+	{
+		value = (value << 1) | ((src[*bit_pos / 8] >> (7 - *bit_pos % 8)) & 1);
+		(*bit_pos)++;
+	}
+	return (value);
+}
+
+// Forme creuse (paires symbole/longueur) si elle est plus courte que la dense
+static bool	is_sparse(int used, int width)
+{
+	return (used * (8 + width) < MAX_SYMBOLS * width);
+}
+
+/* Taille totale de la table des longueurs, déduite de ses deux premiers
+octets. Renvoie 2 tant que ces octets ne sont pas tous disponibles */
+size_t	code_lengths_size(const unsigned char *src, size_t available)
+{
+	int	used, width;
+
+	if (available < 1)
+		return (2);
+	if (src[0] == 0)
+		return (1);
+	if (available < 2)
+		return (2);
+	used = src[1] + 1;
+	width = length_width(src[0]);
+	if (is_sparse(used, width))
+		return (2 + (used * (8 + width) + 7) / 8);
+	return (2 + (MAX_SYMBOLS * width + 7) / 8);
+}
+
+/* Plus petite table de longueurs possible pour used symboles : la longueur
+maximale vaut au moins log2(used) arrondi au-dessus, et la taille de la
+table croît avec elle. Borne basse de write_code_lengths, sans les longueurs */
+size_t	code_lengths_min_size(int used)
+{
+	unsigned char	head[2];
+	int				max_length;
+
+	if (used <= 0)
+		return (1);
+	max_length = 1;
+	while ((1 << max_length) < used)
+		max_length++;
+	head[0] = max_length;
+	head[1] = used - 1;
+	return (code_lengths_size(head, 2));
+}
+
+/* En-tête compact des longueurs :
+- 1 octet : longueur maximale (0 si aucun symbole)
+- 1 octet : nombre de symboles utilisés moins un
+- puis, sur width bits par longueur, soit les 256 longueurs (forme dense),
+  soit des paires symbole/longueur (forme creuse) si c'est plus court
+Écrit au plus CODE_LENGTHS_MAX_SIZE octets et renvoie le nombre écrit */
+size_t	write_code_lengths(unsigned char *dst, const uint8_t *lengths)
+{
+	int		max_length, used, width;
+	size_t	bit_pos;
+
+	max_length = 0;
+	used = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (lengths[i] > max_length)
+			max_length = lengths[i];
+		if (lengths[i])
+			used++;
+	}
+	dst[0] = max_length;
+	if (max_length == 0)
+		return (1);
+	dst[1] = used - 1;
+	width = length_width(max_length);
+	memset(dst + 2, 0, code_lengths_size(dst, 2) - 2);
+	bit_pos = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (is_sparse(used, width))
+		{
+			if (!lengths[i])
+				continue;
+			put_bits(dst + 2, &bit_pos, i, 8);
+		}
+		put_bits(dst + 2, &bit_pos, lengths[i], width);
+	}
+	return (2 + (bit_pos + 7) / 8);
+}
+
+// Relit la table des longueurs ; renvoie le nombre d'octets lus, 0 si invalide
+size_t	read_code_lengths(const unsigned char *src, size_t size, uint8_t *lengths)
+{
+	int		used, width;
+	size_t	total, bit_pos;
+
+	memset(lengths, 0, MAX_SYMBOLS);
+	total = code_lengths_size(src, size);
+	if (total > size)
+		return (0);
+	if (src[0] == 0)
+		return (1);
+	used = src[1] + 1;
+	width = length_width(src[0]);
+	bit_pos = 0;
+	if (is_sparse(used, width))
+	{
+		for (int i = 0; i < used; i++)
+		{
+			uint32_t symbol = get_bits(src + 2, &bit_pos, 8);
+			lengths[symbol] = get_bits(src + 2, &bit_pos, width);
+		}
+		return (total);
+	}
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		lengths[i] = get_bits(src + 2, &bit_pos, width);
+	return (total);
+}
@@ -0,0 +1,95 @@
+#include "../includes/huffman.h"
+
+/* CRC32C (polynôme de Castagnoli, forme réfléchie 0x82F63B78), le contrôle
+de chaque bloc en version HUFF_VERSION_CHECKED. Sur x86-64 avec SSE 4.2,
+l'instruction crc32 traite 8 octets par cycle ; ailleurs, les tables
+"slice-by-8" traitent 8 octets par tour de boucle avec 8 lectures de table
+indépendantes */
+
+static uint32_t			g_crc_tables[8][256];
+static pthread_once_t	g_crc_once = PTHREAD_ONCE_INIT;
+static bool				g_crc_hardware;
+
+// Table t[k][b] : CRC de l'octet b suivi de k octets nuls
+static void	init_crc_tables(void)
+{
+	uint32_t	crc;
+
+	for (int b = 0; b < 256; b++)
+	{
+		crc = b;
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ (0x82F63B78u & -(crc & 1));
+		g_crc_tables[0][b] = crc;
+	}
+	for (int k = 1; k < 8; k++)
+		for (int b = 0; b < 256; b++)
+			g_crc_tables[k][b] = (g_crc_tables[k - 1][b] >> 8)
+				^ g_crc_tables[0][g_crc_tables[k - 1][b] & 0xFF];
+#if defined(__x86_64__)
+	g_crc_hardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t	crc32c_tables(uint32_t crc, const unsigned char *data, size_t size)
+{
+	uint64_t	word;
+
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		memcpy(&word, data, sizeof(word));
+		word ^= crc;
+		crc = g_crc_tables[7][word & 0xFF] ^ g_crc_tables[6][(word >> 8) & 0xFF]
+			^ g_crc_tables[5][(word >> 16) & 0xFF] ^ g_crc_tables[4][(word >> 24) & 0xFF]
+			^ g_crc_tables[3][(word >> 32) & 0xFF] ^ g_crc_tables[2][(word >> 40) & 0xFF]
+			^ g_crc_tables[1][(word >> 48) & 0xFF] ^ g_crc_tables[0][word >> 56];
+	}
+	for (; size > 0; size--, data++)
+		crc = (crc >> 8) ^ g_crc_tables[0][(crc ^ *data) & 0xFF];
+	return (crc);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t	crc32c_hardware(uint32_t crc, const unsigned char *data, size_t size)
+{
+	uint64_t	word, wide;
+
+	wide = crc;
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		memcpy(&word, data, sizeof(word));
+		wide = __builtin_ia32_crc32di(wide, word);
+	}
+	crc = wide;
+	for (; size > 0; size--, data++)
+		crc = __builtin_ia32_crc32qi(crc, *data);
+	return (crc);
+}
+#endif
+
+/* Prolonge le CRC32C crc (0 pour commencer) avec size octets : le calcul
+par morceaux donne la même valeur que crc32c sur le tout (valeur initiale
+et finale inversées, comme iSCSI ou ext4) */
+uint32_t	crc32c_update(uint32_t crc, const void *data, size_t size)
+{
+	uint64_t	start;
+
+	pthread_once(&g_crc_once, init_crc_tables);
+	start = stats_start();
+	crc = ~crc;
+#if defined(__x86_64__)
+	if (g_crc_hardware)
+		crc = crc32c_hardware(crc, data, size);
+	else
+#endif
+		crc = crc32c_tables(crc, data, size);
+	stats_stop(STAT_CHECKSUM, start);
+	return (~crc);
+}
+
+// CRC32C de size octets
+uint32_t	crc32c(const void *data, size_t size)
+{
+	return (crc32c_update(0, data, size));
+}
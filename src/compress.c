@@ -1,209 +1,5 @@
 #include "../includes/huffman.h"
 
-// Libère la mémoire allouée pour l'arbre de Huffman
-void free_huffman_tree(HuffmanNode *root) 
-{
-	if (!root)
-		return;
-	free_huffman_tree(root->left);
-	free_huffman_tree(root->right);
-	free(root);
-}
-
-// Nettoie la table de Huffman pour libérer la mémoire
-void free_huffman_table(HuffmanTable *table) 
-{
-	if (!table)
-		return;
-	for (int i = 0; i < MAX_SYMBOLS; i++) 
-	{
-		if (table->used[i])
-			free(table->codes[i].code);
-	}
-	free(table);
-}
-
-FrequencyTable	*count_frequencies(FILE *input)
-{
-	FrequencyTable	*table;
-	int				c;
-
-	table = malloc(sizeof(FrequencyTable));
-	if (!table)
-		return (NULL);
-	table->frequencies = calloc(MAX_SYMBOLS, sizeof(uint32_t));
-	if (!table->frequencies)
-	{
-		free(table);
-		return (NULL);
-	}
-	table->total_symbols = 0;
-	table->total_characters = 0;
-
-	// Compte les fréquences
-
-	while ((c = fgetc(input)) != EOF)
-	{
-		if (table->frequencies[c] == 0) 
-			table->total_symbols++; // Le nombre de symboles uniques
-		table->frequencies[c]++;
-		table->total_characters++;
-	}
-	rewind(input); // Remet le curseur au début du fichier
-
-	return (table);
-}
-
-HuffmanNode	*create_node(unsigned char c, uint32_t freq)
-{
-	HuffmanNode	*node;
-
-	node = malloc(sizeof(HuffmanNode));
-	if (!node)
-		return (NULL);
-
-	node->character = c;
-	node->frequency = freq;
-	node->left = NULL;
-	node->right = NULL;
-	node->is_leaf = true; // Feuille par défaut (ça peut changer)
-
-	return (node);
-}
-
-HuffmanNode	*build_huffman_tree(FrequencyTable *freq_table)
-{
-	HuffmanNode	**nodes;
-	int			node_count;
-	int			min1_idx, min2_idx;
-	HuffmanNode	*parent;
-
-	if (!freq_table || !freq_table->frequencies || freq_table->total_symbols == 0)
-		return (NULL);
-
-	nodes = malloc(freq_table->total_symbols * sizeof(HuffmanNode *));
-
-	if (!nodes)
-		return (NULL);
-
-	// Créer les noeuds feuilles initiaux
-
-	node_count = 0;
-
-	for (int i = 0; i < MAX_SYMBOLS; i++)
-	{
-		if (freq_table->frequencies[i] > 0)
-		{
-			nodes[node_count] = create_node(i, freq_table->frequencies[i]);
-			if (!nodes[node_count])
-			{
-				// Nettoyage et sortie
-
-				for (int j = 0; j < node_count; j++)
-					free(nodes[j]);
-
-				free(nodes);
-
-				return (NULL);
-			}
-			node_count++;
-		}
-	}
-	// Construire l'arbre
-	while (node_count > 1)
-	{
-		// Trouver les deux noeuds minimaux
-		min1_idx = 0, min2_idx = 1;
-
-		if (nodes[min1_idx]->frequency > nodes[min2_idx]->frequency)
-			SWAP(min1_idx, min2_idx);
-
-		for (int i = 2; i < node_count; i++)
-		{
-			if (nodes[i]->frequency < nodes[min1_idx]->frequency)
-			{
-				min2_idx = min1_idx;
-				min1_idx = i;
-			}
-
-			else if (nodes[i]->frequency < nodes[min2_idx]->frequency)
-				min2_idx = i;
-		}
-
-		// Créer le noeudd parent
-		parent = create_node(0, nodes[min1_idx]->frequency + nodes[min2_idx]->frequency);
-		if (!parent)
-		{
-			// Nettoyage et sortie
-			for (int i = 0; i < node_count; i++)
-				free(nodes[i]);
-			free(nodes);
-			return (NULL);
-		}
-		parent->is_leaf = false;
-		parent->left = nodes[min1_idx];
-		parent->right = nodes[min2_idx];
-
-		// Remplacer min1 par le parent et min2 par le dernier nœud
-		nodes[min1_idx] = parent;
-		nodes[min2_idx] = nodes[node_count - 1];
-		node_count--;
-	}
-	HuffmanNode *root = nodes[0];
-	free(nodes);
-	return (root);
-}
-
-void generate_codes_recursive(HuffmanNode *node, uint8_t *current_code, size_t depth, HuffmanTable *table) 
-{
-	if (!node)
-		return;
-
-	// Si nous sommes à un noeud feuille, stocker le code
-	if (node->is_leaf) 
-	{
-		// Allouer l'espace pour le code (arrondi à l'octet supérieur)
-		size_t bytes = (depth + 7) / 8;
-
-		table->codes[node->character].code = malloc(bytes);
-		if (!table->codes[node->character].code)
-			return;
-		// Copier le chemin actuel comme code
-		memcpy(table->codes[node->character].code, current_code, bytes);
-		table->codes[node->character].length = depth;
-		table->used[node->character] = true;
-		return;
-	}
-
-	// Parcourir à gauche (ajouter 0)
-	if (node->left) 
-	{
-		current_code[depth / 8] &= ~(1 << (7 - (depth % 8)));  // Mettre le bit à 0
-		generate_codes_recursive(node->left, current_code, depth + 1, table);
-	}
-
-	// Parcourir à droite (ajouter 1)
-	if (node->right) 
-	{
-		current_code[depth / 8] |= (1 << (7 - (depth % 8)));   // Mettre le bit à 1
-		generate_codes_recursive(node->right, current_code, depth + 1, table);
-	}
-}
-
-HuffmanTable	*generate_huffman_codes(HuffmanNode *root)
-{
-	HuffmanTable	*table;
-	uint8_t			current_code[MAX_TREE_HEIGHT / 8] = {0};
-
-	table = calloc(1, sizeof(HuffmanTable));
-	if (!table)
-		return (NULL);
-
-	// Tableau temporaire pour construire les codes
-	generate_codes_recursive(root, current_code, 0, table);
-	return (table);
-}
-
 char	*get_compressed_filename(char *input_file)
 {
 	char	*output;
@@ -223,125 +19,25 @@ char	*get_compressed_filename(char *input_file)
 	return (output);
 }
 
-bool write_compressed_file(FILE *input, FILE *output, FrequencyTable *freq_table, HuffmanTable *codes) 
-{
-	// 1. D'abord écrire la table de fréquences comme en-tête
-	// Écrire le nombre de symboles uniques
-	fwrite(&freq_table->total_symbols, sizeof(uint32_t), 1, output);
-	
-	// Écrire les fréquences pour les symboles utilisés
-	for (int i = 0; i < MAX_SYMBOLS; i++) 
-	{
-		if (freq_table->frequencies[i] > 0) 
-		{
-			// Écrire le symbole et sa fréquence
-			fwrite(&i, sizeof(unsigned char), 1, output);
-			fwrite(&freq_table->frequencies[i], sizeof(uint32_t), 1, output);
-		}
-	}
-	
-	// 2. Écrire les données compressées
-	unsigned char bit_buffer = 0;  // Buffer pour stocker les bits avant l'écriture
-	int bits_in_buffer = 0;       // Nombre de bits actuellement dans le buffer
-	int c;
-	
-	// Relire le fichier d'entrée et écrire les données compressées
-	rewind(input);
-	while ((c = fgetc(input)) != EOF) 
-	{
-		// Obtenir le code pour ce caractère
-		uint8_t *code = codes->codes[c].code;
-		uint32_t code_length = codes->codes[c].length;
-		
-		// Écrire les bits du code
-		for (uint32_t i = 0; i < code_length; i++) 
-		{
-			// Obtenir le bit actuel du code
-			unsigned char current_bit = (code[i / 8] >> (7 - (i % 8))) & 1;
-			// Ajouter le bit au buffer
-			bit_buffer = (bit_buffer << 1) | current_bit;
-			bits_in_buffer++;
-			// Si le buffer est plein, l'écrire dans le fichier
-			if (bits_in_buffer == 8) 
-			{
-				fwrite(&bit_buffer, 1, 1, output);
-				bit_buffer = 0;
-				bits_in_buffer = 0;
-			}
-		}
-	}
-	// Écrire les bits restants dans le buffer
-	if (bits_in_buffer > 0) 
-	{
-		// Compléter avec des zéros pour terminer l'octet
-		bit_buffer <<= (8 - bits_in_buffer);
-		fwrite(&bit_buffer, 1, 1, output);
-	}
-	return (true);
-}
-
-/* Écrit la définition d'un noeud dans le fichier DOT
-Gère différents cas pour l'affichage des caractères spéciaux */
-void	write_node_definition(FILE *dot_file, HuffmanNode *node, int node_id)
-{
-    // Si c'est pas un noeud feuille, afficher la fréquence
-    if (!node->is_leaf)
-        fprintf(dot_file, "    node%d [label=\"%d\", shape=circle];\n", node_id,
-            node->frequency);
-    else
-    {
-        // Pour les caractères spéciaux
-        if (node->character == ' ')
-            fprintf(dot_file, "    node%d [label=\"espace\\n%d\", shape=box];\n", 
-            node_id, node->frequency);
-        else if (node->character < 32 || node->character > 126)
-            fprintf(dot_file, "    node%d [label=\"byte %d\\n%d\", shape=box];\n", 
-            node_id, node->character, node->frequency);
-        else if (node->character == '"' || node->character == '\\')
-            fprintf(dot_file, "    node%d [label=\"\\%c\\n%d\", shape=box];\n", 
-            node_id, node->character, node->frequency);
-        else
-            fprintf(dot_file, "    node%d [label=\"%c\\n%d\", shape=box];\n", 
-            node_id, node->character, node->frequency);
-    }
-}
-
-/* Parcourt l'arbre de façon récursive et écrit les connections entre les noeuds
-Retourne l'ID du dernier noeud traité */
-int	write_tree_recursive(FILE *dot_file, HuffmanNode *node, int current_id)
+// Libère toutes les ressources allouées pendant la compression
+void cleanup(char *filename, InputBuffer *input, FILE *output)
 {
-    int	my_id;
-
-    my_id = current_id;
-    if (!node)
-        return (current_id);
-    write_node_definition(dot_file, node, my_id);
-    if (node->left)
-    {
-        fprintf(dot_file, "    node%d -> node%d [label=\"0\"];\n", my_id,
-            current_id + 1);
-        current_id = write_tree_recursive(dot_file, node->left, current_id + 1);
-    }
-    if (node->right)
-    {
-        fprintf(dot_file, "    node%d -> node%d [label=\"1\"];\n", my_id,
-            current_id + 1);
-        current_id = write_tree_recursive(dot_file, node->right, current_id + 1);
-    }
-    return (current_id);
+	if (filename)
+		free(filename);
+	if (input)
+		close_input(input);
+	if (output)
+		fclose(output);
 }
 
-void print_compression_stats(FILE *input_file, FILE *compressed_file, double compression_time) 
+void print_compression_stats(uint64_t original_size, FILE *compressed_file, double compression_time) 
 {
 	struct stat file_info;
-	size_t original_size = 0, compressed_size = 0;
+	uint64_t compressed_size = 0;
 	double compression_ratio = 0.0;
 
-	// Obtenir la taille du fichier original
-	if (fstat(fileno(input_file), &file_info) == 0)
-		original_size = file_info.st_size;
-
 	// Obtenir la taille du fichier compressé
+	fflush(compressed_file);
 	if (fstat(fileno(compressed_file), &file_info) == 0)
 		compressed_size = file_info.st_size;
 
@@ -351,74 +47,314 @@ void print_compression_stats(FILE *input_file, FILE *compressed_file, double com
 
 	printf("\n=== Statistiques de Compression ===\n");
 	printf("Temps de compression: %.4f secondes\n", compression_time);
-	printf("Taille originale: %zu octets\n", original_size);
-	printf("Taille compressée: %zu octets\n", compressed_size);
+	printf("Taille originale: %" PRIu64 " octets\n", original_size);
+	printf("Taille compressée: %" PRIu64 " octets\n", compressed_size);
 	printf("Taux de compression: %.2fx\n", compression_ratio);
 	printf("Espace économisé: %.2f%%\n", (1.0 - (double)compressed_size / original_size) * 100.0);
 }
 
-// Libère toutes les ressources allouées pendant la compression
-void cleanup(char *filename, FrequencyTable *freq_table, HuffmanTable *codes, FILE *input, FILE *output, HuffmanNode *root)
+/* Entraîne une table partagée sur les fichiers du corpus et l'enregistre dans
+path. Chaque fichier projeté est compté par morceaux sur les threads de pool.
+L'identifiant affiché est celui que portent les fichiers compressés */
+static int	train_table(const char *path, char **corpus, int count, int max_length, ThreadPool *pool)
 {
-	if (filename)
-		free(filename);
-	if (freq_table)
+	HuffDictionary	dict;
+	InputBuffer		*input;
+	uint64_t		counts[MAX_SYMBOLS] = {0};
+
+	for (int i = 0; i < count; i++)
+	{
+		input = open_input(corpus[i]);
+		if (!input)
+		{
+			perror(corpus[i]);
+			return (1);
+		}
+		count_histogram_parallel(input->data, input->size, counts, pool);
+		close_input(input);
+	}
+	if (!train_dictionary(counts, max_length, &dict) || !save_dictionary(&dict, path))
 	{
-		free(freq_table->frequencies);
-		free(freq_table);
+		fprintf(stderr, "%s : impossible d'enregistrer la table\n", path);
+		free_dictionary(&dict);
+		return (1);
 	}
-	if (codes)
-		free_huffman_table(codes);
-	if (input)
-		fclose(input);
-	if (output)
-		fclose(output);
-	if (root)
-		free_huffman_tree(root);
+	printf("Table %08" PRIx32 " entraînée sur %d fichier(s), codes de %d bits au plus\n",
+		dict.id, count, dict.max_length);
+	free_dictionary(&dict);
+	return (0);
+}
+
+/* Mode lot (-b) : compresse chaque fichier des chemins donnés (répertoires
+parcourus récursivement) ou de la liste lue sur l'entrée standard ("-" ou
+aucun chemin), vers <fichier>.huff, puis affiche un bilan global */
+static int	compress_batch(char **paths, int count, const EncodeOptions *options,
+	const HuffDictionary *dict, int threads, const char *stats_format)
+{
+	HuffBatch		batch;
+	HuffStats		stats;
+	ThreadPool		*pool;
+	struct timeval	start, end;
+	double			elapsed;
+	bool			ok;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.options = options;
+	batch.dict = dict->codes ? dict : NULL;
+	gettimeofday(&start, NULL);
+	if (stats_format)
+		huff_stats_enable(&stats);
+	ok = true;
+	if (count == 0)
+		ok = read_batch_list(&batch, stdin);
+	for (int i = 0; ok && i < count; i++)
+	{
+		if (strcmp(paths[i], "-") == 0)
+			ok = read_batch_list(&batch, stdin);
+		else if (!add_batch_path(&batch, paths[i]))
+		{
+			perror(paths[i]);
+			ok = false;
+		}
+	}
+	pool = ok ? pool_create(threads) : NULL;
+	ok = pool && run_batch(&batch, pool);
+	gettimeofday(&end, NULL);
+	for (size_t i = 0; ok && i < batch.count; i++)
+		if (batch.errors[i] != 0)
+			fprintf(stderr, "%s : %s\n", batch.paths[i],
+				batch.errors[i] > 0 ? strerror(batch.errors[i]) : "erreur pendant la compression");
+	if (ok)
+	{
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+		printf("\n=== Bilan du mode lot ===\n");
+		printf("Fichiers compressés: %zu sur %zu (%d threads)\n", batch.count - (size_t)batch.failed,
+			batch.count, pool->thread_count);
+		printf("Temps total: %.4f secondes\n", elapsed);
+		printf("Taille originale: %" PRIu64 " octets\n", batch.bytes_in);
+		printf("Taille compressée: %" PRIu64 " octets\n", batch.bytes_out);
+		printf("Taux de compression: %.2fx\n", batch.bytes_out ? (double)batch.bytes_in / batch.bytes_out : 0.0);
+		printf("Débit: %.2f Mo/s, %.0f fichiers/s\n", elapsed > 0 ? batch.bytes_in / elapsed / 1e6 : 0.0,
+			elapsed > 0 ? batch.count / elapsed : 0.0);
+	}
+	else
+		fprintf(stderr, "Erreur pendant la préparation du lot\n");
+	if (stats_format)
+	{
+		huff_stats_enable(NULL);
+		print_stats(stderr, &stats, "compress", stats_format);
+	}
+	pool_destroy(pool);
+	ok = ok && batch.failed == 0;
+	free_batch(&batch);
+	return (ok ? 0 : 1);
+}
+
+static void	usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-ci] [-D table] [-L longueur] [-O ordre] [-T threads] [--stats[=format]] [fichier]\n", name);
+	fprintf(stderr, "       %s -b [-i] [-D table] [-L longueur] [-O ordre] [-T threads] [chemin|-]...\n", name);
+	fprintf(stderr, "       %s -t table [-L longueur] corpus...\n", name);
+	fprintf(stderr, "  -b          mode lot : chaque fichier des chemins (répertoires parcourus) ou de la\n");
+	fprintf(stderr, "              liste lue sur l'entrée standard vers <fichier>.huff, un par thread\n");
+	fprintf(stderr, "  -c          écrire le résultat sur la sortie standard\n");
+	fprintf(stderr, "  -i          ajouter un index des blocs (accès direct avec decompress --range)\n");
+	fprintf(stderr, "  -D table    coder avec une table partagée, sans table dans le fichier (sans -i, -L,\n");
+	fprintf(stderr, "              -O, ni -T hors du mode lot)\n");
+	fprintf(stderr, "  -t table    entraîner une table partagée sur les fichiers du corpus\n");
+	fprintf(stderr, "  -L longueur longueur maximale d'un code, de 1 à %d (défaut %d)\n",
+		MAX_CODE_LENGTH, DEFAULT_CODE_LENGTH_LIMIT);
+	fprintf(stderr, "  -O ordre    1 : une table par octet précédent quand c'est plus court (défaut 0)\n");
+	fprintf(stderr, "  -T threads  compresser les blocs en parallèle (0 = un par processeur, défaut en mode lot\n");
+	fprintf(stderr, "              et pour -t)\n");
+	fprintf(stderr, "  --stats[=format]\n");
+	fprintf(stderr, "              mesures par phase sur la sortie d'erreur, format text (défaut) ou json\n");
+	fprintf(stderr, "Sans fichier (ou avec -), lit l'entrée standard et écrit sur la sortie standard\n");
 }
 
 int	main(int argc, char **argv)
 {
-	FrequencyTable	*freq_table;
 	char			*output_filename;
-	HuffmanNode		*root;
-	HuffmanTable	*codes;
-	FILE *input, *output;
+	InputBuffer		*input;
+	FILE			*output;
+	OutputBuffer	*compressed;
+	bool			seen[MAX_SYMBOLS] = {false};
+	bool			to_stdout, streaming, batch, ok;
+	uint32_t		total_symbols;
 	struct timeval start, end;
 	double compression_time;
+	ThreadPool		*pool;
+	EncodeOptions	options;
+	HuffDictionary	dict = {0};
+	HuffStats		stats;
+	const char		*dict_path, *train_path, *stats_format;
+	int				opt, threads;
+	static const struct option	long_options[] = {
+		{"stats", optional_argument, NULL, 'S'},
+		{NULL, 0, NULL, 0}
+	};
+
+	to_stdout = false;
+	batch = false;
+	threads = -1;
+	dict_path = NULL;
+	train_path = NULL;
+	stats_format = NULL;
+	options.max_code_length = DEFAULT_CODE_LENGTH_LIMIT;
+	options.context_order = 0;
+	options.write_index = false;
+	while ((opt = getopt_long(argc, argv, "bcD:iL:O:T:t:", long_options, NULL)) != -1)
+	{
+		if (opt == 'S' && (!optarg || strcmp(optarg, "text") == 0 || strcmp(optarg, "json") == 0))
+			stats_format = optarg ? optarg : "text";
+		else if (opt == 'c')
+			to_stdout = true;
+		else if (opt == 'b')
+			batch = true;
+		else if (opt == 'i')
+			options.write_index = true;
+		else if (opt == 'D')
+			dict_path = optarg;
+		else if (opt == 't')
+			train_path = optarg;
+		else if (opt == 'L' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_CODE_LENGTH)
+			options.max_code_length = atoi(optarg);
+		else if (opt == 'O' && (strcmp(optarg, "0") == 0 || strcmp(optarg, "1") == 0))
+			options.context_order = atoi(optarg);
+		else if (opt == 'T')
+			threads = resolve_thread_count(atoi(optarg));
+		else
+		{
+			usage(argv[0]);
+			return (1);
+		}
+	}
+	if (train_path)
+	{
+		if (optind >= argc)
+		{
+			usage(argv[0]);
+			return (1);
+		}
+		pool = pool_create(threads < 0 ? resolve_thread_count(0) : threads);
+		opt = pool ? train_table(train_path, argv + optind, argc - optind, options.max_code_length, pool) : 1;
+		pool_destroy(pool);
+		return (opt);
+	}
+	// Avec une table partagée, le fichier est un seul flux de codes sans blocs
+	if (dict_path && (options.write_index || options.context_order != 0
+		|| options.max_code_length != DEFAULT_CODE_LENGTH_LIMIT || (threads >= 0 && !batch)))
+	{
+		fprintf(stderr, "-D ne se combine pas avec -i, -L ni -O, ni avec -T hors du mode lot\n");
+		usage(argv[0]);
+		return (1);
+	}
+	if (dict_path && !load_dictionary(dict_path, &dict))
+	{
+		fprintf(stderr, "%s : table invalide ou illisible\n", dict_path);
+		return (1);
+	}
+	if (batch)
+	{
+		opt = compress_batch(argv + optind, argc - optind, &options, &dict,
+			threads < 0 ? resolve_thread_count(0) : threads, stats_format);
+		free_dictionary(&dict);
+		return (opt);
+	}
+	// Mode flux : de l'entrée standard vers la sortie standard
+	streaming = optind >= argc || strcmp(argv[optind], "-") == 0;
+	if (streaming)
+		to_stdout = true;
 
 	// Donne le temps au début de la compression
 	gettimeofday(&start, NULL);
-
-	// Génération du nom du fichier de sortie
-	output_filename = get_compressed_filename(argv[1]);
+	if (stats_format)
+		huff_stats_enable(&stats);
 
 	// Initialisation des fichiers d'entrée et de sortie 
-	input = fopen(argv[1], "rb");
-	output = fopen(output_filename, "wb");
-
-	// Phase 1: Analyse des fréquences des caractères
-	freq_table = count_frequencies(input);
-	printf("Trouvé %u symboles uniques sur %u caractères au total\n",
-		freq_table->total_symbols, freq_table->total_characters);
-
-	// Phase 2: Construction de l'arbre de Huffman et génération des codes
-	root = build_huffman_tree(freq_table);
-	codes = generate_huffman_codes(root);
-
-	// Phase 3: Compression et écriture du fichier
-	write_compressed_file(input, output, freq_table, codes);
+	// L'entrée est lue une seule fois et sert aux deux passes
+	input = NULL;
+	output_filename = NULL;
+	if (!streaming || dict.codes)
+	{
+		// Avec une table, l'entrée standard est lue en entier : la taille précède les codes
+		input = streaming ? open_input_fd(STDIN_FILENO) : open_input(argv[optind]);
+		if (!input)
+		{
+			perror(streaming ? "stdin" : argv[optind]);
+			free_dictionary(&dict);
+			return (1);
+		}
+	}
+	if (to_stdout)
+		output = stdout;
+	else
+	{
+		// Génération du nom du fichier de sortie
+		output_filename = get_compressed_filename(argv[optind]);
+		output = output_filename ? fopen(output_filename, "wb") : NULL;
+		if (!output)
+		{
+			perror(output_filename ? output_filename : argv[optind]);
+			cleanup(output_filename, input, NULL);
+			free_dictionary(&dict);
+			return (1);
+		}
+	}
+	compressed = open_output(output);
+	pool = pool_create(threads < 0 ? 1 : threads);
+	if (dict.codes)
+		ok = compressed && write_dictionary_file(&dict, input->data, input->size, compressed, seen);
+	else if (streaming)
+		ok = compressed && pool && write_compressed_stream(stdin, compressed, seen, pool, &options);
+	else
+		ok = compressed && pool && write_compressed_file(input->data, input->size, compressed, seen, pool, &options);
+	ok = close_output(compressed) && ok;
+	pool_destroy(pool);
+	if (!ok)
+		fprintf(stderr, "Erreur pendant la compression\n");
 
 	// Donne le temps à la fin de la compression
 	gettimeofday(&end, NULL);
 
-	// Calculer le temps de compression
-	compression_time = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	total_symbols = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		total_symbols += seen[i];
+	// Mesures demandées par --stats, sur la sortie d'erreur même en mode flux
+	if (stats_format)
+	{
+		huff_stats_enable(NULL);
+		stats.counters[STAT_SYMBOLS] = total_symbols;
+		print_stats(stderr, &stats, "compress", stats_format);
+	}
 
-	printf("Fichier compressé avec succès!\n");
+	// Les statistiques ne sont affichées que si la sortie est un fichier compressé sans erreur
+	if (ok && !to_stdout)
+	{
+		printf("Trouvé %u symboles uniques sur %zu caractères au total\n",
+			total_symbols, input->size);
 
-	// Afficher les statistiques de compression
-	print_compression_stats(input, output, compression_time);
-	cleanup(output_filename, freq_table, codes, input, output, root);
-	return (0);
-}
\ No newline at end of file
+		// Calculer le temps de compression
+		compression_time = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+
+		printf("Fichier compressé avec succès!\n");
+
+		// Afficher les statistiques de compression
+		print_compression_stats(input->size, output, compression_time);
+	}
+	// Un échec ne laisse pas de fichier .huff tronqué
+	if (!ok && output_filename)
+	{
+		fclose(output);
+		output = NULL;
+		unlink(output_filename);
+	}
+	if (output == stdout)
+	{
+		fflush(stdout);
+		output = NULL;
+	}
+	cleanup(output_filename, input, output);
+	free_dictionary(&dict);
+	return (ok ? 0 : 1);
+}
@@ -0,0 +1,126 @@
+#include "../includes/huffman.h"
+
+/* Blocs à contextes (ordre 1) : chaque octet est codé avec la table de l'octet
+qui le précède dans le bloc, le premier avec la table 0. Forme du bloc :
+- 1 octet : CONTEXT_BLOCK
+- les 256 tables de longueurs, dans l'ordre des contextes, au format compact
+  de write_code_lengths (1 octet pour un contexte jamais rencontré)
+- les codes, poids fort en premier, complétés par des zéros */
+
+/* Compte les paires (précédent, octet) du bloc et choisit les longueurs des
+codes de chaque contexte. Renvoie la taille exacte du bloc à contextes */
+static size_t	model_block(const unsigned char *data, size_t size, ContextModel *model,
+	const EncodeOptions *options)
+{
+	FrequencyTable	freq_table;
+	uint64_t		frequencies[MAX_SYMBOLS];
+	unsigned char	header[CODE_LENGTHS_MAX_SIZE];
+	unsigned char	previous;
+	uint64_t		bits;
+	size_t			tables_size;
+
+	previous = 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		model->counts[previous][data[i]]++;
+		previous = data[i];
+	}
+	freq_table.frequencies = frequencies;
+	tables_size = 1;
+	bits = 0;
+	for (int c = 0; c < MAX_SYMBOLS; c++)
+	{
+		freq_table.total_symbols = 0;
+		freq_table.total_characters = 0;
+		for (int i = 0; i < MAX_SYMBOLS; i++)
+		{
+			frequencies[i] = model->counts[c][i];
+			freq_table.total_symbols += frequencies[i] > 0;
+			freq_table.total_characters += frequencies[i];
+		}
+		model->used[c] = freq_table.total_symbols > 0;
+		if (model->used[c])
+		{
+			choose_code_lengths(&freq_table, options, model->lengths[c]);
+			stats_code_lengths(model->lengths[c]);
+			bits += coded_bits(&freq_table, model->lengths[c]);
+		}
+		tables_size += write_code_lengths(header, model->lengths[c]);
+	}
+	return (tables_size + (bits + 7) / 8);
+}
+
+/* Code le bloc avec une table par contexte s'il tient en moins de limit
+octets. Le coût des 256 tables est compté : les petits blocs et les données
+sans dépendance d'un octet à l'autre restent codés en ordre 0. Le modèle et
+les tables sont pris dans arena. Renvoie la taille écrite dans dst, 0 si la
+forme à contextes n'est pas retenue */
+size_t	encode_context_block(const unsigned char *data, size_t size, unsigned char *dst,
+	const EncodeOptions *options, size_t limit, HuffArena *arena)
+{
+	ContextModel	*model;
+	BitWriter		writer;
+
+	model = arena_alloc(arena, sizeof(ContextModel));
+	if (!model || model_block(data, size, model, options) >= limit)
+		return (0);
+	dst[0] = CONTEXT_BLOCK;
+	writer.dst = dst;
+	writer.pos = 1;
+	writer.bits = 0;
+	writer.count = 0;
+	for (int c = 0; c < MAX_SYMBOLS; c++)
+	{
+		writer.pos += write_code_lengths(dst + writer.pos, model->lengths[c]);
+		if (!model->used[c])
+			continue;
+		model->codes[c] = generate_canonical_codes(model->lengths[c], arena);
+		if (!model->codes[c])
+			return (0);
+	}
+	encode_context_symbols(&writer, data, size, model->codes);
+	flush_bits(&writer);
+	return (writer.pos);
+}
+
+/* Lit la marque et les 256 tables de longueurs d'un bloc à contextes, et
+construit dans arena la table de décodage de chaque contexte rencontré (NULL
+pour les autres). Renvoie le nombre d'octets lus, 0 si les tables sont
+invalides */
+size_t	read_context_tables(const unsigned char *src, size_t size, DecodeTable **tables,
+	HuffArena *arena)
+{
+	uint8_t	lengths[MAX_SYMBOLS];
+	size_t	pos, used;
+
+	memset(tables, 0, MAX_SYMBOLS * sizeof(DecodeTable *));
+	if (size == 0 || src[0] != CONTEXT_BLOCK)
+		return (0);
+	pos = 1;
+	for (int c = 0; c < MAX_SYMBOLS; c++)
+	{
+		used = read_code_lengths(src + pos, size - pos, lengths);
+		// Longueur maximale nulle : contexte absent du bloc
+		if (used == 0 || (src[pos] != 0 && !(tables[c] = build_canonical_decode_table(lengths, arena))))
+			return (0);
+		pos += used;
+	}
+	return (pos);
+}
+
+// Décode un bloc à contextes entièrement en mémoire vers raw_size octets
+bool	decode_context_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+	size_t raw_size, HuffArena *arena)
+{
+	DecodeTable		*tables[MAX_SYMBOLS];
+	BitReader		reader;
+	unsigned char	previous;
+	size_t			used;
+
+	used = read_context_tables(packed, packed_size, tables, arena);
+	if (used == 0)
+		return (false);
+	init_block_reader(&reader, packed + used, packed_size - used);
+	previous = 0;
+	return (decode_context_symbols(&reader, tables, &previous, raw, raw_size));
+}
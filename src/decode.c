@@ -0,0 +1,946 @@
+#include "../includes/huffman.h"
+
+/* Arbre de l'ancien format. Le décodeur doit retrouver exactement l'arbre de
+l'ancien compresseur, y compris l'ordre des fils : on garde donc sa recherche
+linéaire des deux minimums et son ordre de remplacement, en O(k²). Ce n'est
+fait qu'une fois par fichier de l'ancien format */
+bool	build_legacy_tree(const FrequencyTable *freq_table, HuffmanTree *tree)
+{
+	int16_t	nodes[MAX_SYMBOLS];
+	int		node_count;
+	int		min1_idx, min2_idx;
+
+	tree->count = 0;
+	tree->root = -1;
+	if (!freq_table || !freq_table->frequencies || freq_table->total_symbols == 0)
+		return (false);
+	// Créer les noeuds feuilles initiaux
+	node_count = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (freq_table->frequencies[i] > 0)
+			nodes[node_count++] = add_node(tree, i, freq_table->frequencies[i], -1, -1);
+	if (node_count == 0)
+		return (false);
+	// Construire l'arbre
+	while (node_count > 1)
+	{
+		// Trouver les deux noeuds minimaux
+		min1_idx = 0, min2_idx = 1;
+		if (tree->nodes[nodes[min1_idx]].frequency > tree->nodes[nodes[min2_idx]].frequency)
+			SWAP(min1_idx, min2_idx);
+		for (int i = 2; i < node_count; i++)
+		{
+			if (tree->nodes[nodes[i]].frequency < tree->nodes[nodes[min1_idx]].frequency)
+			{
+				min2_idx = min1_idx;
+				min1_idx = i;
+			}
+			else if (tree->nodes[nodes[i]].frequency < tree->nodes[nodes[min2_idx]].frequency)
+				min2_idx = i;
+		}
+		// Remplacer min1 par le parent et min2 par le dernier nœud
+		nodes[min1_idx] = add_node(tree, 0, tree->nodes[nodes[min1_idx]].frequency
+				+ tree->nodes[nodes[min2_idx]].frequency, nodes[min1_idx], nodes[min2_idx]);
+		nodes[min2_idx] = nodes[node_count - 1];
+		node_count--;
+	}
+	tree->root = nodes[0];
+	return (true);
+}
+
+FrequencyTable *read_frequency_table(FILE *input)
+{
+	uint32_t total_symbols;
+
+	// Lire d'abord le nombre de symboles
+	if (fread(&total_symbols, sizeof(uint32_t), 1, input) != 1)
+		return NULL;
+	return read_frequency_pairs(input, total_symbols);
+}
+
+/* Lit les paires symbole-fréquence, le nombre de symboles étant déjà lu.
+L'ancien compresseur n'écrit que les symboles présents, chacun une fois :
+un symbole répété ou de fréquence nulle rend la table invalide */
+FrequencyTable *read_frequency_pairs(FILE *input, uint32_t total_symbols)
+{
+	FrequencyTable *table;
+	size_t read_size;
+
+	if (total_symbols > MAX_SYMBOLS)
+		return NULL;
+	table = malloc(sizeof(FrequencyTable));
+	if (!table)
+		return NULL;
+
+	table->frequencies = calloc(MAX_SYMBOLS, sizeof(uint64_t));
+	if (!table->frequencies)
+	{
+		free(table);
+		return NULL;
+	}
+
+	table->total_symbols = total_symbols;
+	table->total_characters = 0;
+
+	// Lire chaque paire symbole-fréquence
+	for (uint32_t i = 0; i < table->total_symbols; i++)
+	{
+		unsigned char symbol;
+		uint32_t frequency;
+
+		read_size = fread(&symbol, sizeof(unsigned char), 1, input);
+		if (read_size != 1)
+		{
+			free(table->frequencies);
+			free(table);
+			return NULL;
+		}
+
+		read_size = fread(&frequency, sizeof(uint32_t), 1, input);
+		if (read_size != 1 || frequency == 0 || table->frequencies[symbol] != 0)
+		{
+			free(table->frequencies);
+			free(table);
+			return NULL;
+		}
+
+		table->frequencies[symbol] = frequency;
+		table->total_characters += frequency;
+	}
+
+	return table;
+}
+
+// Décodeur de référence : parcours de l'arbre bit par bit
+bool decode_file(FILE *input, FILE *output, const HuffmanTree *tree, uint64_t total_characters)
+{
+	int current;
+	unsigned char bit_buffer;
+	uint64_t characters_written = 0;
+	int bit_position;
+
+	if (!tree || tree->root < 0 || !input || !output)
+		return false;
+	current = tree->root;
+
+	while (characters_written < total_characters)
+	{
+		// Lire un nouvel octet
+		if (fread(&bit_buffer, sizeof(unsigned char), 1, input) != 1)
+			return false;
+
+		// Traiter chaque bit de l'octet
+		for (bit_position = 7; bit_position >= 0 && characters_written < total_characters; bit_position--)
+		{
+			// Extraire le bit actuel
+			bool bit = (bit_buffer >> bit_position) & 1;
+
+			// Naviguer dans l'arbre
+			if (bit)
+				current = tree->nodes[current].right;
+			else
+				current = tree->nodes[current].left;
+
+			// Vérification de sécurité
+			if (current < 0)
+				return false;
+
+			// Si on atteint une feuille
+			if (tree->nodes[current].is_leaf)
+			{
+				if (fputc(tree->nodes[current].character, output) == EOF)
+					return false;
+				characters_written++;
+				current = tree->root; // Retour à la racine
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Remplit la table en parcourant l'arbre jusqu'à DECODE_TABLE_BITS de profondeur.
+Une feuille couvre toutes les entrées qui commencent par son code, un noeud
+interne situé à la profondeur maximale est gardé pour le chemin lent */
+static void	fill_decode_table(DecodeTable *table, int index, uint32_t code, int depth)
+{
+	const HuffmanNode	*node;
+	uint32_t			first;
+	uint32_t			count;
+
+	if (index < 0)
+		return;
+	node = &table->tree->nodes[index];
+	if (node->is_leaf)
+	{
+		first = code << (DECODE_TABLE_BITS - depth);
+		count = 1u << (DECODE_TABLE_BITS - depth);
+		for (uint32_t i = 0; i < count; i++)
+			table->entries[first + i] = node->character | (depth << 8);
+		return;
+	}
+	if (depth == DECODE_TABLE_BITS)
+	{
+		table->entries[code] = 0;
+		table->subtrees[code] = index;
+		return;
+	}
+	fill_decode_table(table, node->left, code << 1, depth + 1);
+	fill_decode_table(table, node->right, (code << 1) | 1, depth + 1);
+}
+
+/* Table de décodage pour l'ancien format, dont les codes viennent de l'arbre.
+L'arbre doit rester valide tant que la table sert */
+DecodeTable	*build_decode_table(const HuffmanTree *tree)
+{
+	DecodeTable	*table;
+
+	if (!tree || tree->root < 0)
+		return (NULL);
+	table = calloc(1, sizeof(DecodeTable));
+	if (!table)
+		return (NULL);
+	table->single_symbol = -1;
+	table->tree = tree;
+	// Un seul symbole : le code est vide, le nombre de caractères suffit
+	if (tree->nodes[tree->root].is_leaf)
+		table->single_symbol = tree->nodes[tree->root].character;
+	else
+		fill_decode_table(table, tree->root, 0, 0);
+	return (table);
+}
+
+/* Vrai si les longueurs forment un code complet : chaque suite de bits
+commence par un code. Les encodeurs n'écrivent que des codes complets, sauf
+pour un symbole seul (un code d'un bit) ; une table incomplète ne peut venir
+que d'un fichier corrompu */
+static bool	complete_code(const uint8_t *lengths)
+{
+	uint32_t	count[MAX_CODE_LENGTH + 1] = {0};
+	uint64_t	left;
+
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		count[lengths[i]]++;
+	if (count[0] == MAX_SYMBOLS - 1 && count[1] == 1)
+		return (true);
+	// Au-delà de MAX_SYMBOLS codes libres, les symboles restants ne peuvent plus les remplir
+	left = 1;
+	for (int len = 1; len <= MAX_CODE_LENGTH && left <= MAX_SYMBOLS; len++)
+		left = 2 * left - count[len];
+	return (left == 0);
+}
+
+/* Table de décodage construite directement à partir des longueurs canoniques,
+sans arbre. Les codes plus longs que DECODE_TABLE_BITS sont résolus par longueur
+croissante grâce au premier code et au nombre de codes de chaque longueur.
+Renvoie NULL si les longueurs ne forment pas un code préfixe complet. La
+table est prise dans arena, ou sur le tas sans arène (NULL) */
+DecodeTable	*build_canonical_decode_table(const uint8_t *lengths, HuffArena *arena)
+{
+	DecodeTable	*table;
+	uint64_t	codes[MAX_SYMBOLS];
+	uint32_t	first, count;
+	int			len, index;
+
+	if (!assign_canonical_codes(lengths, codes) || !complete_code(lengths))
+		return (NULL);
+	table = arena_alloc(arena, sizeof(DecodeTable));
+	if (!table)
+		return (NULL);
+	table->single_symbol = -1;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		len = lengths[i];
+		if (len == 0)
+			continue;
+		table->count[len]++;
+		if (len > table->max_length)
+			table->max_length = len;
+		if (len > DECODE_TABLE_BITS)
+			continue;
+		first = codes[i] << (DECODE_TABLE_BITS - len);
+		count = 1u << (DECODE_TABLE_BITS - len);
+		for (uint32_t j = 0; j < count; j++)
+			table->entries[first + j] = i | (len << 8);
+	}
+	// Symboles rangés dans l'ordre canonique : par longueur puis par valeur
+	index = 0;
+	for (len = 1; len <= table->max_length; len++)
+	{
+		table->first_index[len] = index;
+		for (int i = 0; i < MAX_SYMBOLS; i++)
+		{
+			if (lengths[i] != len)
+				continue;
+			if (table->first_index[len] == index)
+				table->first_code[len] = codes[i];
+			table->symbols[index++] = i;
+		}
+	}
+	return (table);
+}
+
+/* Recharge le mot de bits. Loin de la fin des données, 8 octets sont lus en
+une fois et les octets entiers qui tiennent dans le mot sont consommés (aucun
+quand count dépasse 56) : les bits chargés au-delà de count sont ceux qui
+suivent dans le flux et seront relus à l'identique. Près de la fin, les octets sont lus un par un et le mot
+est complété par des zéros */
+static inline void	refill_bits(BitReader *reader)
+{
+	uint64_t	word;
+
+	// Sans test sur count : la seule branche reste prévisible
+	if (reader->size - reader->pos >= sizeof(word))
+	{
+		memcpy(&word, reader->data + reader->pos, sizeof(word));
+		reader->bits |= __builtin_bswap64(word) >> reader->count;
+		reader->pos += (63 - reader->count) >> 3;
+		reader->count |= 56;
+		return;
+	}
+	while (reader->count <= 56)
+	{
+		if (reader->pos == reader->size)
+		{
+			if (!reader->input)
+				return;
+			reader->size = fread(reader->buffer, 1, IO_BLOCK_SIZE, reader->input);
+			reader->pos = 0;
+			stats_count(STAT_READ_CALLS, 1);
+			stats_count(STAT_BYTES_IN, reader->size);
+			if (reader->size == 0)
+				return;
+		}
+		reader->bits |= (uint64_t)reader->data[reader->pos++] << (56 - reader->count);
+		reader->count += 8;
+	}
+}
+
+// Lit le bit suivant, ou renvoie -1 si l'entrée est épuisée
+static int	next_bit(BitReader *reader)
+{
+	int	bit;
+
+	if (reader->count == 0)
+		refill_bits(reader);
+	if (reader->count == 0)
+		return (-1);
+	bit = reader->bits >> 63;
+	reader->bits <<= 1;
+	reader->count--;
+	return (bit);
+}
+
+/* Chemin lent : termine un code plus long que DECODE_TABLE_BITS dont les
+premiers bits valent index. Renvoie le symbole ou -1 si le code est invalide */
+static int	decode_slow(BitReader *reader, DecodeTable *table, uint32_t index)
+{
+	const HuffmanNode	*nodes;
+	int					current;
+	uint64_t			code;
+	int					bit;
+
+	if (table->tree)
+	{
+		nodes = table->tree->nodes;
+		current = table->subtrees[index];
+		while (!nodes[current].is_leaf)
+		{
+			if ((bit = next_bit(reader)) < 0)
+				return (-1);
+			current = bit ? nodes[current].right : nodes[current].left;
+			if (current < 0)
+				return (-1);
+		}
+		return (nodes[current].character);
+	}
+	code = index;
+	for (int len = DECODE_TABLE_BITS + 1; len <= table->max_length; len++)
+	{
+		if ((bit = next_bit(reader)) < 0)
+			return (-1);
+		code = (code << 1) | bit;
+		if (code >= table->first_code[len] && code - table->first_code[len] < table->count[len])
+			return (table->symbols[table->first_index[len] + code - table->first_code[len]]);
+	}
+	return (-1);
+}
+
+/* Décode un symbole : DECODE_TABLE_BITS bits résolus par une lecture de la
+table. Renvoie le symbole, ou -1 si le code est invalide ou tronqué */
+static inline int	decode_next(BitReader *reader, DecodeTable *table)
+{
+	BitReader	slow;
+	uint16_t	entry;
+	uint32_t	index;
+	int			symbol;
+
+	refill_bits(reader);
+	index = reader->bits >> (64 - DECODE_TABLE_BITS);
+	entry = table->entries[index];
+	// Chemin rapide : le code tient dans la table
+	if (entry)
+	{
+		if ((entry >> 8) > reader->count)
+			return (-1);
+		reader->bits <<= entry >> 8;
+		reader->count -= entry >> 8;
+		return (entry & 0xFF);
+	}
+	if (reader->count < DECODE_TABLE_BITS)
+		return (-1);
+	reader->bits <<= DECODE_TABLE_BITS;
+	reader->count -= DECODE_TABLE_BITS;
+	/* Le chemin lent travaille sur une copie : l'adresse de reader ne sort pas
+	de la fonction, un lecteur local peut donc rester dans les registres */
+	slow = *reader;
+	symbol = decode_slow(&slow, table, index);
+	*reader = slow;
+	return (symbol);
+}
+
+/* Décode count symboles dans dst avec une seule table. Quand la table a
+un noyau spécialisé, il décode tant qu'il reste 8 octets à lire ; la boucle
+générique prend le relais près de la fin des données, ou le temps de
+recharger le buffer d'un FILE, puis rend la main au noyau */
+bool	decode_symbols(BitReader *reader, DecodeTable *table, unsigned char *dst, size_t count)
+{
+	DecodeKernel	kernel;
+	BitReader		local;
+	size_t			i;
+	int				symbol;
+
+	if (table->single_symbol >= 0)
+	{
+		memset(dst, table->single_symbol, count);
+		return (true);
+	}
+	kernel = decode_kernel(table);
+	// Copie locale du lecteur, gardée dans les registres pendant la boucle
+	local = *reader;
+	i = 0;
+	while (i < count)
+	{
+		if (kernel)
+			i += kernel(&local, table, dst + i, count - i);
+		if (i == count)
+			break;
+		symbol = decode_next(&local, table);
+		if (symbol < 0)
+			return (false);
+		dst[i++] = symbol;
+	}
+	*reader = local;
+	return (true);
+}
+
+/* Décode count symboles avec une table par contexte : chaque symbole est lu
+dans la table de l'octet précédent, *previous au départ. *previous reçoit le
+dernier octet décodé pour reprendre le décodage à l'appel suivant */
+bool	decode_context_symbols(BitReader *reader, DecodeTable *const *tables, unsigned char *previous,
+	unsigned char *dst, size_t count)
+{
+	int	symbol;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!tables[*previous])
+			return (false);
+		symbol = decode_next(reader, tables[*previous]);
+		if (symbol < 0)
+			return (false);
+		dst[i] = symbol;
+		*previous = symbol;
+	}
+	return (true);
+}
+
+/* Décodeur par table sur un FILE : les symboles sont décodés directement dans
+le buffer de sortie, IO_BLOCK_SIZE octets à la fois */
+bool decode_file_table(FILE *input, OutputBuffer *output, DecodeTable *table, uint64_t total_characters)
+{
+	BitReader	reader;
+	uint64_t	remaining, start;
+	size_t		chunk;
+	bool		ok;
+
+	if (total_characters == 0)
+		return (true);
+	if (!table || !input || !output)
+		return (false);
+	reader.buffer = malloc(IO_BLOCK_SIZE);
+	if (!reader.buffer)
+		return (false);
+	reader.input = input;
+	reader.data = reader.buffer;
+	reader.pos = 0;
+	reader.size = 0;
+	reader.bits = 0;
+	reader.count = 0;
+	ok = true;
+	remaining = total_characters;
+	while (ok && remaining > 0)
+	{
+		if (output->pos == IO_BLOCK_SIZE)
+			flush_output(output);
+		chunk = IO_BLOCK_SIZE - output->pos;
+		if (chunk > remaining)
+			chunk = remaining;
+		start = stats_start();
+		ok = decode_symbols(&reader, table, output->buffer + output->pos, chunk);
+		stats_stop(STAT_DECODE, start);
+		output->pos += chunk;
+		remaining -= chunk;
+	}
+	free(reader.buffer);
+	return (ok && !output->error);
+}
+
+// Prépare la lecture des bits d'un bloc déjà en mémoire
+void	init_block_reader(BitReader *reader, const unsigned char *src, size_t size)
+{
+	reader->input = NULL;
+	reader->data = src;
+	reader->buffer = NULL;
+	reader->pos = 0;
+	reader->size = size;
+	reader->bits = 0;
+	reader->count = 0;
+}
+
+// Décode un bloc entièrement en mémoire : size octets compressés vers count symboles
+bool	decode_block(const unsigned char *src, size_t size, unsigned char *dst, size_t count, DecodeTable *table)
+{
+	BitReader	reader;
+
+	if (count == 0)
+		return (true);
+	if (!table)
+		return (false);
+	init_block_reader(&reader, src, size);
+	return (decode_symbols(&reader, table, dst, count));
+}
+
+// Lit l'en-tête du format canonique qui suit la signature (total sur 32 bits)
+bool	read_canonical_header(FILE *input, uint64_t *total_characters, uint8_t *lengths)
+{
+	unsigned char	header[CODE_LENGTHS_MAX_SIZE];
+	uint32_t		total;
+	size_t			size;
+
+	if (fread(&total, sizeof(uint32_t), 1, input) != 1)
+		return (false);
+	*total_characters = total;
+	// Les deux premiers octets donnent la taille du reste de la table
+	if (fread(header, 1, 1, input) != 1)
+		return (false);
+	size = code_lengths_size(header, 1);
+	if (size > 1 && fread(header + 1, 1, 1, input) != 1)
+		return (false);
+	size = code_lengths_size(header, 2);
+	if (size > 2 && fread(header + 2, 1, size - 2, input) != size - 2)
+		return (false);
+	return (read_code_lengths(header, size, lengths) == size);
+}
+
+/* Lit la signature et la version du fichier. Les fichiers de l'ancien format
+commencent directement par le nombre de symboles (version 0) : les 4 octets
+lus sont alors laissés dans signature. Renvoie -1 si le fichier est plus
+court que 4 octets */
+int	read_format_version(FILE *input, unsigned char *signature)
+{
+	size_t	got;
+
+	got = fread(signature, 1, 4, input);
+	stats_count(STAT_READ_CALLS, 1);
+	stats_count(STAT_BYTES_IN, got);
+	if (got != 4)
+		return (-1);
+	if (memcmp(signature, HUFF_MAGIC, 3) == 0)
+		return (signature[3]);
+	return (HUFF_VERSION_LEGACY);
+}
+
+/* Lit l'en-tête et le contenu compressé d'un bloc. Renvoie 1 si un bloc a été
+lu, 0 à la fin du fichier (bloc 0 0) et -1 si le fichier est invalide */
+static int	read_block(FILE *input, BlockJob *job)
+{
+	uint32_t	header[2];
+	uint64_t	start;
+
+	// En-tête du bloc : taille décodée puis taille compressée
+	start = stats_start();
+	stats_count(STAT_READ_CALLS, 1);
+	if (fread(header, sizeof(uint32_t), 2, input) != 2)
+		return (-1);
+	stats_count(STAT_BYTES_IN, sizeof(header));
+	if (header[0] == 0)
+		return (0);
+	// Un bloc a au moins un octet de contenu (marque ou table)
+	if (header[0] > HUFF_MAX_BLOCK_SIZE || header[1] == 0 || header[1] > HUFF_BLOCK_BOUND(header[0]))
+		return (-1);
+	stats_count(STAT_READ_CALLS, 1);
+	if (!reserve_buffer(&job->packed, &job->packed_capacity, header[1])
+		|| !reserve_buffer(&job->raw, &job->raw_capacity, header[0])
+		|| fread(job->packed, 1, header[1], input) != header[1])
+		return (-1);
+	stats_stop(STAT_READ, start);
+	stats_count(STAT_BYTES_IN, header[1]);
+	job->raw_size = header[0];
+	job->packed_size = header[1];
+	return (1);
+}
+
+/* Taille du segment index quand un bloc de size octets est coupé en
+SPLIT_STREAMS segments consécutifs : tous font un quart arrondi au-dessus,
+sauf le dernier qui prend le reste */
+size_t	split_segment(size_t size, int index)
+{
+	size_t	quarter;
+
+	quarter = (size + SPLIT_STREAMS - 1) / SPLIT_STREAMS;
+	if (size <= index * quarter)
+		return (0);
+	if (size - index * quarter < quarter)
+		return (size - index * quarter);
+	return (quarter);
+}
+
+/* Boucle des flux multiples : un symbole de chaque flux par tour, les quatre
+chaînes de lectures de table sont indépendantes et s'exécutent en parallèle
+dans le processeur. Les lecteurs sont copiés dans des variables locales pour
+rester dans les registres : les écritures dans dst ne peuvent pas les toucher */
+static bool	decode_four_streams(BitReader *readers, DecodeTable *restrict table,
+	unsigned char *restrict dst, size_t quarter, size_t count)
+{
+	SplitKernel	kernel;
+	BitReader	r0, r1, r2, r3;
+	size_t		j;
+	int			a, b, c, d;
+	bool		ok;
+
+	// Noyau spécialisé tant que les quatre flux ont 8 octets d'avance
+	kernel = split_kernel(table);
+	j = kernel ? kernel(readers, table, dst, quarter, count) : 0;
+	r0 = readers[0];
+	r1 = readers[1];
+	r2 = readers[2];
+	r3 = readers[3];
+	ok = true;
+	for (; ok && j < count; j++)
+	{
+		a = decode_next(&r0, table);
+		b = decode_next(&r1, table);
+		c = decode_next(&r2, table);
+		d = decode_next(&r3, table);
+		ok = (a | b | c | d) >= 0;
+		dst[j] = a;
+		dst[quarter + j] = b;
+		dst[2 * quarter + j] = c;
+		dst[3 * quarter + j] = d;
+	}
+	readers[0] = r0;
+	readers[1] = r1;
+	readers[2] = r2;
+	readers[3] = r3;
+	return (ok);
+}
+
+/* Décode un bloc à flux multiples : marque SPLIT_BLOCK, table des longueurs,
+tailles des SPLIT_STREAMS - 1 premiers flux (32 bits) puis les flux. Chaque
+flux code un segment consécutif du bloc ; la boucle lit un symbole de chaque
+flux à chaque tour. La table est prise dans arena */
+bool	decode_split_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+	size_t raw_size, HuffArena *arena)
+{
+	uint8_t		lengths[MAX_SYMBOLS];
+	uint32_t	sizes[SPLIT_STREAMS - 1];
+	BitReader	readers[SPLIT_STREAMS];
+	DecodeTable	*table;
+	size_t		pos, used, quarter, last;
+	bool		ok;
+
+	used = packed_size > 0 ? read_code_lengths(packed + 1, packed_size - 1, lengths) : 0;
+	pos = 1 + used;
+	if (used == 0 || packed_size - pos < sizeof(sizes))
+		return (false);
+	memcpy(sizes, packed + pos, sizeof(sizes));
+	pos += sizeof(sizes);
+	for (int k = 0; k < SPLIT_STREAMS - 1; k++)
+	{
+		if (sizes[k] > packed_size - pos)
+			return (false);
+		init_block_reader(&readers[k], packed + pos, sizes[k]);
+		pos += sizes[k];
+	}
+	init_block_reader(&readers[SPLIT_STREAMS - 1], packed + pos, packed_size - pos);
+	table = build_canonical_decode_table(lengths, arena);
+	if (!table)
+		return (false);
+	quarter = split_segment(raw_size, 0);
+	last = split_segment(raw_size, SPLIT_STREAMS - 1);
+	ok = decode_four_streams(readers, table, raw, quarter, last);
+	// Les premiers segments peuvent avoir quelques symboles de plus que le dernier
+	for (int k = 0; ok && k < SPLIT_STREAMS - 1; k++)
+		ok = decode_symbols(&readers[k], table, raw + k * quarter + last,
+				split_segment(raw_size, k) - last);
+	return (ok);
+}
+
+// Contenu d'un bloc selon sa forme (voir decode_packed_block)
+static bool	decode_packed_content(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+	size_t raw_size, HuffArena *arena)
+{
+	uint8_t		lengths[MAX_SYMBOLS];
+	size_t		used;
+
+	if (packed_size > 0 && packed[0] == STORED_BLOCK)
+	{
+		if (packed_size != raw_size + 1)
+			return (false);
+		memcpy(raw, packed + 1, raw_size);
+		return (true);
+	}
+	if (packed_size > 0 && packed[0] == CONTEXT_BLOCK)
+		return (decode_context_block(packed, packed_size, raw, raw_size, arena));
+	if (packed_size > 0 && packed[0] == SPLIT_BLOCK)
+		return (decode_split_block(packed, packed_size, raw, raw_size, arena));
+	used = read_code_lengths(packed, packed_size, lengths);
+	if (used == 0)
+		return (false);
+	return (decode_block(packed + used, packed_size - used, raw, raw_size,
+			build_canonical_decode_table(lengths, arena)));
+}
+
+/* Décode le contenu d'un bloc (table des longueurs puis données codées)
+vers raw_size octets. Un bloc stocké est simplement copié, un bloc à
+contextes a sa propre forme (context.c). Les tables sont prises dans
+arena, que l'appelant remet à zéro entre deux blocs. Le temps passé compte
+dans la phase STAT_DECODE, sans le contrôle CRC32C qui a sa propre phase */
+bool	decode_packed_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+	size_t raw_size, HuffArena *arena)
+{
+	uint64_t	start;
+	bool		ok;
+
+	start = stats_start();
+	ok = decode_packed_content(packed, packed_size, raw, raw_size, arena);
+	stats_stop(STAT_DECODE, start);
+	stats_count(STAT_BLOCKS, 1);
+	return (ok);
+}
+
+/* Bloc de la version HUFF_VERSION_CHECKED : le contenu est suivi du CRC32C
+des octets décodés, recalculé après le décodage. Un bit faux dans les codes
+comme dans les données stockées est ainsi détecté */
+bool	decode_checked_block(const unsigned char *packed, size_t packed_size, unsigned char *raw,
+	size_t raw_size, HuffArena *arena)
+{
+	uint32_t	expected;
+
+	if (packed_size < CHECKSUM_SIZE)
+		return (false);
+	packed_size -= CHECKSUM_SIZE;
+	memcpy(&expected, packed + packed_size, CHECKSUM_SIZE);
+	return (decode_packed_block(packed, packed_size, raw, raw_size, arena)
+		&& crc32c(raw, raw_size) == expected);
+}
+
+/* Tâche parallèle : décode le bloc index du lot. Les tables du bloc
+précédent de la même tâche sont rendues à son arène d'abord */
+void	decode_job(void *context, size_t index)
+{
+	BlockJob	*job;
+
+	job = (BlockJob *)context + index;
+	huff_arena_reset(&job->arena);
+	if (job->checksum)
+		job->ok = decode_checked_block(job->packed, job->packed_size, job->raw, job->raw_size, &job->arena);
+	else
+		job->ok = decode_packed_block(job->packed, job->packed_size, job->raw, job->raw_size, &job->arena);
+}
+
+// Taille décodée annoncée par un en-tête, comparée à la limite avant de décoder
+static bool	check_output_size(uint64_t total, const DecodeOptions *options)
+{
+	if (total <= options->max_output)
+		return (true);
+	fprintf(stderr, "Taille décodée annoncée (%" PRIu64 " octets) supérieure à la limite de %"
+		PRIu64 " octets\n", total, options->max_output);
+	return (false);
+}
+
+/* Décode un fichier découpé en blocs. Les blocs sont lus par lots (quelques
+blocs par thread), décodés en parallèle sur le groupe de threads puis écrits
+dans l'ordre. La mémoire utilisée reste bornée quelle que soit la taille du
+fichier. options->pool peut être NULL pour tout décoder dans le thread
+appelant. Un bloc qui ferait dépasser options->max_output est refusé dès son
+en-tête, avant d'être décodé.
+En versions HUFF_VERSION_LARGE et HUFF_VERSION_CHECKED, la taille totale
+écrite après le dernier bloc doit être égale à la somme des blocs décodés ;
+en HUFF_VERSION_CHECKED, chaque bloc est aussi contrôlé par son CRC32C */
+bool	decode_blocks(FILE *input, OutputBuffer *output, int version, const DecodeOptions *options)
+{
+	ThreadPool	*pool;
+	BlockJob	*jobs;
+	size_t		batch, count;
+	uint64_t	decoded, announced, total;
+	int			status;
+	bool		ok;
+
+	pool = options->pool;
+	batch = (pool ? pool->thread_count : 1) * BLOCKS_PER_THREAD;
+	jobs = calloc(batch, sizeof(BlockJob));
+	if (!jobs)
+		return (false);
+	for (size_t i = 0; i < batch; i++)
+		jobs[i].checksum = version == HUFF_VERSION_CHECKED;
+	ok = true;
+	status = 1;
+	decoded = 0;
+	announced = 0;
+	while (ok && status == 1)
+	{
+		count = 0;
+		while (count < batch && (status = read_block(input, &jobs[count])) == 1)
+		{
+			announced += jobs[count++].raw_size;
+			if (!check_output_size(announced, options))
+			{
+				status = -1;
+				break;
+			}
+		}
+		ok = status >= 0;
+		pool_run(pool, ok ? count : 0, decode_job, jobs);
+		for (size_t i = 0; ok && i < count; i++)
+		{
+			ok = jobs[i].ok;
+			if (ok)
+				write_output(output, jobs[i].raw, jobs[i].raw_size);
+			decoded += jobs[i].raw_size;
+		}
+	}
+	if (ok && (version == HUFF_VERSION_LARGE || version == HUFF_VERSION_CHECKED))
+	{
+		ok = fread(&total, sizeof(total), 1, input) == 1 && total == decoded;
+		stats_count(STAT_READ_CALLS, 1);
+		stats_count(STAT_BYTES_IN, sizeof(total));
+	}
+	for (size_t i = 0; i < batch; i++)
+	{
+		free(jobs[i].raw);
+		free(jobs[i].packed);
+		huff_arena_free(&jobs[i].arena);
+	}
+	free(jobs);
+	return (ok && !output->error);
+}
+
+/* Fichier de version 4 : les codes de la table partagée suivent son
+identifiant et la taille décodée */
+static bool	decode_dictionary_input(FILE *input, OutputBuffer *output, const DecodeOptions *options)
+{
+	const HuffDictionary	*dict;
+	uint64_t				total;
+	uint32_t				dict_id;
+	bool					ok;
+
+	dict = options->dict;
+	ok = fread(&dict_id, sizeof(dict_id), 1, input) == 1 && fread(&total, sizeof(total), 1, input) == 1;
+	stats_count(STAT_READ_CALLS, 2);
+	stats_count(STAT_BYTES_IN, ok ? sizeof(dict_id) + sizeof(total) : 0);
+	if (ok && (!dict || !dict->table))
+	{
+		fprintf(stderr, "Fichier compressé avec la table %08" PRIx32 " : utiliser -D\n", dict_id);
+		return (false);
+	}
+	if (ok && dict_id != dict->id)
+	{
+		fprintf(stderr, "Fichier compressé avec la table %08" PRIx32 ", pas %08" PRIx32 "\n",
+			dict_id, dict->id);
+		return (false);
+	}
+	return (ok && check_output_size(total, options)
+		&& decode_file_table(input, output, dict->table, total));
+}
+
+/* Fichiers à une seule table : codes canoniques (version 1) ou ancien format
+(version 0, dont les 4 octets de signature sont le nombre de symboles) */
+static bool	decode_single_table_input(FILE *input, OutputBuffer *output, int version,
+	const unsigned char *signature, const DecodeOptions *options)
+{
+	FrequencyTable	*freq_table;
+	HuffmanTree		*tree;
+	DecodeTable		*table;
+	uint8_t			lengths[MAX_SYMBOLS];
+	uint64_t		total;
+	uint32_t		total_symbols;
+	bool			ok;
+
+	freq_table = NULL;
+	tree = NULL;
+	table = NULL;
+	total = 0;
+	if (version == HUFF_VERSION_CANONICAL)
+	{
+		// Les codes sont reconstruits à partir de leurs longueurs, sans arbre
+		ok = read_canonical_header(input, &total, lengths);
+		if (ok && options->verbose)
+			printf("Lecture de %" PRIu64 " caractères au total (codes canoniques)\n", total);
+		table = ok ? build_canonical_decode_table(lengths, NULL) : NULL;
+	}
+	else
+	{
+		// Ancien format : table de fréquences puis reconstruction de l'arbre
+		memcpy(&total_symbols, signature, sizeof(uint32_t));
+		freq_table = read_frequency_pairs(input, total_symbols);
+		ok = freq_table != NULL;
+		if (ok && options->verbose)
+			printf("Lecture de %u symboles uniques pour %" PRIu64 " caractères totaux\n",
+				freq_table->total_symbols, freq_table->total_characters);
+		if (ok)
+		{
+			tree = malloc(sizeof(HuffmanTree));
+			if (tree && build_legacy_tree(freq_table, tree))
+				table = build_decode_table(tree);
+			total = freq_table->total_characters;
+			free(freq_table->frequencies);
+			free(freq_table);
+		}
+	}
+	// Décoder le fichier, la sortie est écrite par grands blocs
+	ok = ok && check_output_size(total, options) && decode_file_table(input, output, table, total);
+	free(table);
+	free(tree);
+	return (ok);
+}
+
+/* Décode la suite du fichier, dont la version et les 4 premiers octets
+(signature) ont déjà été lus par read_format_version */
+bool	decode_format(FILE *input, OutputBuffer *output, int version, const unsigned char *signature,
+	const DecodeOptions *options)
+{
+	// Suite de blocs indépendants, chacun avec sa table : décodage parallèle
+	if (version == HUFF_VERSION_BLOCKS || version == HUFF_VERSION_LARGE
+		|| version == HUFF_VERSION_CHECKED)
+		return (decode_blocks(input, output, version, options));
+	if (version == HUFF_VERSION_DICT)
+		return (decode_dictionary_input(input, output, options));
+	if (version == HUFF_VERSION_CANONICAL || version == HUFF_VERSION_LEGACY)
+		return (decode_single_table_input(input, output, version, signature, options));
+	return (false);
+}
+
+/* Décode tout le fichier ouvert dans input vers output, quelle que soit sa
+version. Chaque en-tête est contrôlé avant le décodage : tailles bornées,
+tables de codes complètes, taille décodée au plus options->max_output.
+Renvoie false si le fichier est invalide, tronqué ou trop grand */
+bool	decode_input(FILE *input, OutputBuffer *output, const DecodeOptions *options)
+{
+	unsigned char	signature[4];
+	int				version;
+
+	version = read_format_version(input, signature);
+	return (decode_format(input, output, version, signature, options));
+}
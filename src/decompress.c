@@ -1,188 +1,5 @@
 #include "../includes/huffman.h"
 
-// Libère la mémoire allouée pour l'arbre de Huffman
-void free_huffman_tree(HuffmanNode *root) 
-{
-	if (!root)
-		return;
-	free_huffman_tree(root->left);
-	free_huffman_tree(root->right);
-	free(root);
-}
-
-// Nettoie la table de Huffman pour libérer la mémoire
-void free_huffman_table(HuffmanTable *table) 
-{
-	if (!table)
-		return;
-	for (int i = 0; i < MAX_SYMBOLS; i++) 
-	{
-		if (table->used[i])
-			free(table->codes[i].code);
-	}
-	free(table);
-}
-
-FrequencyTable	*count_frequencies(FILE *input)
-{
-	FrequencyTable	*table;
-	int				c;
-
-	table = malloc(sizeof(FrequencyTable));
-	if (!table)
-		return (NULL);
-	table->frequencies = calloc(MAX_SYMBOLS, sizeof(uint32_t));
-	if (!table->frequencies)
-	{
-		free(table);
-		return (NULL);
-	}
-	table->total_symbols = 0;
-	table->total_characters = 0;
-	// Compte les fréquences
-	while ((c = fgetc(input)) != EOF)
-	{
-		if (table->frequencies[c] == 0) 
-			table->total_symbols++; // Le nombre de symboles uniques
-		table->frequencies[c]++;
-		table->total_characters++;
-	}
-	rewind(input); // Remet le curseur au début du fichier
-	return (table);
-}
-
-HuffmanNode	*create_node(unsigned char c, uint32_t freq)
-{
-	HuffmanNode	*node;
-
-	node = malloc(sizeof(HuffmanNode));
-	if (!node)
-		return (NULL);
-	node->character = c;
-	node->frequency = freq;
-	node->left = NULL;
-	node->right = NULL;
-	node->is_leaf = true; // Feuille par défaut (ça peut changer)
-	return (node);
-}
-
-HuffmanNode	*build_huffman_tree(FrequencyTable *freq_table)
-{
-	HuffmanNode	**nodes;
-	int			node_count;
-	int			min1_idx, min2_idx;
-	HuffmanNode	*parent;
-
-	if (!freq_table || !freq_table->frequencies || freq_table->total_symbols == 0)
-		return (NULL);
-	nodes = malloc(freq_table->total_symbols * sizeof(HuffmanNode *));
-	if (!nodes)
-		return (NULL);
-	// Créer les noeuds feuilles initiaux
-	node_count = 0;
-	for (int i = 0; i < MAX_SYMBOLS; i++)
-	{
-		if (freq_table->frequencies[i] > 0)
-		{
-			nodes[node_count] = create_node(i, freq_table->frequencies[i]);
-			if (!nodes[node_count])
-			{
-				// Nettoyage et sortie
-				for (int j = 0; j < node_count; j++)
-					free(nodes[j]);
-				free(nodes);
-				return (NULL);
-			}
-			node_count++;
-		}
-	}
-	// Construire l'arbre
-	while (node_count > 1)
-	{
-		// Trouver les deux noeuds minimaux
-		min1_idx = 0, min2_idx = 1;
-		if (nodes[min1_idx]->frequency > nodes[min2_idx]->frequency)
-			SWAP(min1_idx, min2_idx);
-		for (int i = 2; i < node_count; i++)
-		{
-			if (nodes[i]->frequency < nodes[min1_idx]->frequency)
-			{
-				min2_idx = min1_idx;
-				min1_idx = i;
-			}
-			else if (nodes[i]->frequency < nodes[min2_idx]->frequency)
-				min2_idx = i;
-		}
-		// Créer le noeudd parent
-		parent = create_node(0, nodes[min1_idx]->frequency + nodes[min2_idx]->frequency);
-		if (!parent)
-		{
-			// Nettoyage et sortie
-			for (int i = 0; i < node_count; i++)
-				free(nodes[i]);
-			free(nodes);
-			return (NULL);
-		}
-		parent->is_leaf = false;
-		parent->left = nodes[min1_idx];
-		parent->right = nodes[min2_idx];
-		// Remplacer min1 par le parent et min2 par le dernier nœud
-		nodes[min1_idx] = parent;
-		nodes[min2_idx] = nodes[node_count - 1];
-		node_count--;
-	}
-	HuffmanNode *root = nodes[0];
-	free(nodes);
-	return (root);
-}
-
-void generate_codes_recursive(HuffmanNode *node, uint8_t *current_code, size_t depth, HuffmanTable *table) 
-{
-	if (!node)
-		return;
-	// Si nous sommes à un noeud feuille, stocker le code
-	if (node->is_leaf) 
-	{
-		// Allouer l'espace pour le code (arrondi à l'octet supérieur)
-		size_t bytes = (depth + 7) / 8;
-		table->codes[node->character].code = malloc(bytes);
-		if (!table->codes[node->character].code)
-			return;
-		// Copier le chemin actuel comme code
-		memcpy(table->codes[node->character].code, current_code, bytes);
-		table->codes[node->character].length = depth;
-		table->used[node->character] = true;
-		return;
-	}
-
-	// Parcourir à gauche (ajouter 0)
-	if (node->left) 
-	{
-		current_code[depth / 8] &= ~(1 << (7 - (depth % 8)));  // Mettre le bit à 0
-		generate_codes_recursive(node->left, current_code, depth + 1, table);
-	}
-
-	// Parcourir à droite (ajouter 1)
-	if (node->right) 
-	{
-		current_code[depth / 8] |= (1 << (7 - (depth % 8)));   // Mettre le bit à 1
-		generate_codes_recursive(node->right, current_code, depth + 1, table);
-	}
-}
-
-HuffmanTable	*generate_huffman_codes(HuffmanNode *root)
-{
-	HuffmanTable	*table;
-	uint8_t			current_code[MAX_TREE_HEIGHT / 8] = {0};
-
-	table = calloc(1, sizeof(HuffmanTable));
-	if (!table)
-		return (NULL);
-	// Tableau temporaire pour construire les codes
-	generate_codes_recursive(root, current_code, 0, table);
-	return (table);
-}
-
 char *get_decompressed_filename(char *compressed_file, char *output_name)
 {
     char *output;
@@ -211,158 +28,387 @@ char *get_decompressed_filename(char *compressed_file, char *output_name)
     return output;
 }
 
-bool decode_file(FILE *input, FILE *output, HuffmanNode *root, uint32_t total_characters)
-{
-    HuffmanNode *current = root;
-    unsigned char bit_buffer;
-    uint32_t characters_written = 0;
-    int bit_position;
-
-    if (!root || !input || !output)
-        return false;
-
-    while (characters_written < total_characters)
-    {
-        // Lire un nouvel octet
-        if (fread(&bit_buffer, sizeof(unsigned char), 1, input) != 1)
-            return false;
-
-        // Traiter chaque bit de l'octet
-        for (bit_position = 7; bit_position >= 0 && characters_written < total_characters; bit_position--)
-        {
-            // Extraire le bit actuel
-            bool bit = (bit_buffer >> bit_position) & 1;
-            
-            // Naviguer dans l'arbre
-			if (bit)
-				current = current->right;
-			else
-				current = current->left;
-            
-            // Si on atteint une feuille
-            if (current && current->is_leaf)
-            {
-                if (fputc(current->character, output) == EOF)
-                    return false;
-                characters_written++;
-                current = root; // Retour à la racine
-            }
-            
-            // Vérification de sécurité
-            if (!current)
-                return false;
-        }
-    }
-    
-    return true;
-}
-
-void cleanup_decompress(char *filename, FrequencyTable *freq_table, HuffmanNode *root, FILE *input, FILE *output)
+void cleanup_decompress(char *filename, FILE *input, FILE *output)
 {
     if (filename)
         free(filename);
-    if (freq_table)
-    {
-        if (freq_table->frequencies)
-            free(freq_table->frequencies);
-        free(freq_table);
-    }
-    if (root)
-        free_huffman_tree(root);
     if (input)
         fclose(input);
     if (output)
         fclose(output);
 }
 
-FrequencyTable *read_frequency_table(FILE *input)
+/* Décompresse seulement la plage "début:longueur" (en octets décodés) du
+fichier, vers output_name ou la sortie standard. Le fichier est projeté en
+mémoire : seules les pages des blocs utiles, et de l'index s'il existe,
+sont lues */
+static int decompress_range(const char *path, const char *output_name, const char *range)
 {
-    FrequencyTable *table;
-    uint32_t total_symbols;
-    size_t read_size;
-
-    // Lire d'abord le nombre de symboles
-    read_size = fread(&total_symbols, sizeof(uint32_t), 1, input);
-    if (read_size != 1)
-        return NULL;
-
-    table = malloc(sizeof(FrequencyTable));
-    if (!table)
-        return NULL;
+    InputBuffer *input;
+    unsigned char *slice;
+    unsigned long long offset, length;
+    char *end;
+    size_t size;
+    FILE *output;
+    int status;
+    bool ok;
+
+    offset = strtoull(range, &end, 10);
+    length = *end == ':' ? strtoull(end + 1, &end, 10) : 0;
+    if (*end != '\0' || end == range || length > SIZE_MAX)
+    {
+        fprintf(stderr, "Plage invalide : %s (attendu début:longueur)\n", range);
+        return 1;
+    }
+    input = open_input(path);
+    if (!input)
+    {
+        perror(path);
+        return 1;
+    }
+    size = length;
+    slice = malloc(size ? size : 1);
+    status = slice ? huff_decompress_range(input->data, input->size, offset, slice, &size) : HUFF_ERROR_MEMORY;
+    close_input(input);
+    output = status == HUFF_OK && output_name ? fopen(output_name, "wb") : stdout;
+    ok = status == HUFF_OK && output && fwrite(slice, 1, size, output) == size;
+    if (ok)
+        stats_count(STAT_BYTES_OUT, size);
+    if (output && output != stdout)
+        ok = fclose(output) == 0 && ok;
+    else
+        ok = fflush(stdout) == 0 && ok;
+    free(slice);
+    if (status == HUFF_ERROR_CORRUPT)
+        fprintf(stderr, "Erreur : fichier invalide ou sans blocs (versions 2, 3 et 5 seulement)\n");
+    else if (!ok)
+        fprintf(stderr, "Erreur pendant l'extraction de la plage\n");
+    return ok ? 0 : 1;
+}
 
-    table->frequencies = calloc(MAX_SYMBOLS, sizeof(uint32_t));
-    if (!table->frequencies)
+/* Fichier vers fichier, formats à blocs (versions 2, 3 et 5) : l'entrée est
+projetée en mémoire, la sortie créée à sa taille finale et projetée aussi,
+puis les blocs sont décodés en parallèle directement à leur place dans la
+sortie, sans stdio ni copie. Renvoie -1 si l'entrée n'a pas ce format (le
+décodage par FILE s'en charge, erreurs comprises), sinon 0 ou 1 */
+static int decompress_mapped(const char *path, const char *output_name, const DecodeOptions *options)
+{
+    InputBuffer *input;
+    unsigned char *map;
+    uint64_t total;
+    size_t size;
+    int fd, status;
+
+    input = open_input(path);
+    if (!input)
+        return -1;
+    if (huff_decompressed_size(input->data, input->size, &total) != HUFF_OK || total > SIZE_MAX)
     {
-        free(table);
-        return NULL;
+        close_input(input);
+        return -1;
+    }
+    // La taille totale est connue avant de créer la sortie : la limite est vérifiée d'abord
+    if (total > options->max_output)
+    {
+        fprintf(stderr, "Taille décodée annoncée (%" PRIu64 " octets) supérieure à la limite de %"
+            PRIu64 " octets\n", total, options->max_output);
+        close_input(input);
+        return 1;
     }
+    fd = open(output_name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        perror(output_name);
+        close_input(input);
+        return 1;
+    }
+    map = map_output(fd, total);
+    status = total == 0 ? HUFF_OK : HUFF_ERROR_MEMORY;
+    if (map)
+    {
+        size = total;
+        status = huff_decompress_pool(input->data, input->size, map, &size, options->pool);
+        munmap(map, total);
+        stats_count(STAT_BYTES_OUT, total);
+    }
+    else if (total > 0)
+        perror(output_name);
+    close_input(input);
+    if (close(fd) != 0 && status == HUFF_OK)
+        status = HUFF_ERROR_MEMORY;
+    if (status != HUFF_OK)
+    {
+        unlink(output_name);
+        if (status == HUFF_ERROR_CORRUPT)
+            fprintf(stderr, "Erreur : fichier compressé invalide ou tronqué\n");
+        return 1;
+    }
+    return 0;
+}
 
-    table->total_symbols = total_symbols;
-    table->total_characters = 0;
+/* Taille en octets, avec un suffixe K, M ou G facultatif (puissances de 1024).
+Renvoie false si le texte n'est pas une taille */
+static bool parse_size(const char *text, uint64_t *size)
+{
+    unsigned long long value;
+    char *end;
+    int shift = 0;
 
-    // Lire chaque paire symbole-fréquence
-    for (uint32_t i = 0; i < table->total_symbols; i++)
-    {
-        unsigned char symbol;
-        uint32_t frequency;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    if (end == text || errno != 0 || text[0] == '-')
+        return false;
+    if (*end == 'K' || *end == 'k')
+        shift = 10;
+    else if (*end == 'M' || *end == 'm')
+        shift = 20;
+    else if (*end == 'G' || *end == 'g')
+        shift = 30;
+    if ((shift > 0 && end[1] != '\0') || (shift == 0 && *end != '\0') || value > (UINT64_MAX >> shift))
+        return false;
+    *size = (uint64_t)value << shift;
+    return true;
+}
 
-        read_size = fread(&symbol, sizeof(unsigned char), 1, input);
-        if (read_size != 1)
+/* Décode chaque fichier sans rien écrire, ce qui contrôle aussi les
+sommes CRC32C des blocs (version HUFF_VERSION_CHECKED). Les autres versions
+n'ont pas de somme : un fichier qui se décode sans erreur est signalé
+« non contrôlé », pas OK. Sans fichier (ou avec -), vérifie l'entrée
+standard. Renvoie 1 si un fichier est invalide */
+static int verify_files(char **paths, int count, const DecodeOptions *options)
+{
+    OutputBuffer *discard;
+    unsigned char signature[4];
+    const char *name;
+    FILE *input;
+    int failed = 0, version;
+    bool ok;
+
+    for (int i = 0; i < count || (i == 0 && count == 0); i++)
+    {
+        name = count > 0 ? paths[i] : "-";
+        input = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+        if (!input)
         {
-            free(table->frequencies);
-            free(table);
-            return NULL;
+            perror(name);
+            failed++;
+            continue;
         }
-
-        read_size = fread(&frequency, sizeof(uint32_t), 1, input);
-        if (read_size != 1)
+        discard = open_output(NULL);
+        version = read_format_version(input, signature);
+        ok = discard && decode_format(input, discard, version, signature, options);
+        ok = close_output(discard) && ok;
+        if (input != stdin)
+            fclose(input);
+        if (ok && version == HUFF_VERSION_CHECKED)
+            printf("%s : OK\n", name);
+        else if (ok)
+            printf("%s : décodé, non contrôlé (version %d sans somme CRC32C)\n", name, version);
+        else
         {
-            free(table->frequencies);
-            free(table);
-            return NULL;
+            fprintf(stderr, "%s : fichier corrompu ou tronqué\n", name);
+            failed++;
         }
-
-        table->frequencies[symbol] = frequency;
-        table->total_characters += frequency;
     }
+    return failed > 0 ? 1 : 0;
+}
 
-    return table;
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c] [-D table] [-T threads] [--max-size taille] [--stats[=format]] [fichier.huff [sortie]]\n", name);
+    fprintf(stderr, "       %s --range début:longueur [--stats[=format]] fichier.huff [sortie]\n", name);
+    fprintf(stderr, "       %s --verify [-D table] [-T threads] [--max-size taille] [fichier.huff...]\n", name);
+    fprintf(stderr, "  -c          écrire le résultat sur la sortie standard\n");
+    fprintf(stderr, "  -D table    table partagée utilisée à la compression (compress -D)\n");
+    fprintf(stderr, "  -r, --range début:longueur\n");
+    fprintf(stderr, "              ne décoder que cette plage (sortie standard sans nom de sortie)\n");
+    fprintf(stderr, "  -T threads  décoder les blocs en parallèle (0 = un par processeur)\n");
+    fprintf(stderr, "  --verify    décoder et contrôler les sommes des blocs sans rien écrire\n");
+    fprintf(stderr, "  --max-size taille\n");
+    fprintf(stderr, "              refuser un fichier qui annonce plus que taille octets décodés (suffixes K, M, G)\n");
+    fprintf(stderr, "  --stats[=format]\n");
+    fprintf(stderr, "              mesures par phase sur la sortie d'erreur, format text (défaut) ou json\n");
+    fprintf(stderr, "Sans fichier (ou avec -), lit l'entrée standard et écrit sur la sortie standard\n");
 }
 
 int main(int argc, char **argv)
 {
     char *output_filename = NULL;
-    FrequencyTable *freq_table = NULL;
-    HuffmanNode *root = NULL;
     FILE *input = NULL, *output = NULL;
-    
-    // Vérifier et créer le nom du fichier de sortie
-    if (argv[2])
-        output_filename = get_decompressed_filename(argv[1], argv[2]);
-    else
-        output_filename = get_decompressed_filename(argv[1], NULL);
-
-    // Ouvrir le fichier d'entrée
-    input = fopen(argv[1], "rb");
-
-    // Ouvrir le fichier de sortie
-    output = fopen(output_filename, "wb");
+    OutputBuffer *decoded;
+    bool to_stdout = false, verify = false, streaming, ok;
+    HuffDictionary dict = {0};
+    DecodeOptions options = {&dict, NULL, UINT64_MAX, false};
+    int opt, status, threads = 1;
+    const char *range = NULL, *stats_format = NULL;
+    HuffStats stats;
+    static const struct option long_options[] = {
+        {"range", required_argument, NULL, 'r'},
+        {"stats", optional_argument, NULL, 'S'},
+        {"verify", no_argument, NULL, 'V'},
+        {"max-size", required_argument, NULL, 'M'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "cD:r:T:", long_options, NULL)) != -1)
+    {
+        if (opt == 'c')
+            to_stdout = true;
+        else if (opt == 'V')
+            verify = true;
+        else if (opt == 'S' && (!optarg || strcmp(optarg, "text") == 0 || strcmp(optarg, "json") == 0))
+            stats_format = optarg ? optarg : "text";
+        else if (opt == 'r')
+            range = optarg;
+        else if (opt == 'M')
+        {
+            if (!parse_size(optarg, &options.max_output))
+            {
+                fprintf(stderr, "Taille invalide : %s\n", optarg);
+                free_dictionary(&dict);
+                return 1;
+            }
+        }
+        else if (opt == 'D')
+        {
+            if (!load_dictionary(optarg, &dict))
+            {
+                fprintf(stderr, "%s : table invalide ou illisible\n", optarg);
+                return 1;
+            }
+        }
+        else if (opt == 'T')
+            threads = resolve_thread_count(atoi(optarg));
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (stats_format)
+        huff_stats_enable(&stats);
+    // Accès direct : seuls les blocs de la plage sont décodés
+    if (range)
+    {
+        free_dictionary(&dict);
+        if (optind >= argc || strcmp(argv[optind], "-") == 0)
+        {
+            fprintf(stderr, "--range demande un fichier, pas l'entrée standard\n");
+            return 1;
+        }
+        ok = decompress_range(argv[optind], optind + 1 < argc ? argv[optind + 1] : NULL, range) == 0;
+        if (stats_format)
+        {
+            huff_stats_enable(NULL);
+            print_stats(stderr, &stats, "range", stats_format);
+        }
+        return ok ? 0 : 1;
+    }
+    options.pool = pool_create(threads);
+    if (!options.pool)
+    {
+        free_dictionary(&dict);
+        return 1;
+    }
+    // Vérification seule : rien n'est écrit
+    if (verify)
+    {
+        status = verify_files(argv + optind, argc - optind, &options);
+        if (stats_format)
+        {
+            huff_stats_enable(NULL);
+            print_stats(stderr, &stats, "verify", stats_format);
+        }
+        pool_destroy(options.pool);
+        free_dictionary(&dict);
+        return status;
+    }
+    // Mode flux : de l'entrée standard vers la sortie standard
+    streaming = optind >= argc || strcmp(argv[optind], "-") == 0;
+    if (streaming)
+        to_stdout = true;
 
-    // Lire la table de fréquences
-    freq_table = read_frequency_table(input);
+    // Fichier vers fichier : sortie projetée en mémoire quand le format s'y prête
+    if (!to_stdout)
+    {
+        output_filename = get_decompressed_filename(argv[optind],
+            optind + 1 < argc ? argv[optind + 1] : NULL);
+        options.verbose = true;
+        status = output_filename ? decompress_mapped(argv[optind], output_filename, &options) : -1;
+        if (status >= 0)
+        {
+            if (stats_format)
+            {
+                huff_stats_enable(NULL);
+                print_stats(stderr, &stats, "decompress", stats_format);
+            }
+            if (status == 0)
+                printf("Fichier décompressé avec succès!\n");
+            free(output_filename);
+            pool_destroy(options.pool);
+            free_dictionary(&dict);
+            return status;
+        }
+    }
 
-    printf("Lecture de %u symboles uniques pour %u caractères totaux\n", 
-           freq_table->total_symbols, freq_table->total_characters);
+    // Ouvrir le fichier d'entrée
+    input = streaming ? stdin : fopen(argv[optind], "rb");
+    if (!input)
+    {
+        perror(argv[optind]);
+        free(output_filename);
+        pool_destroy(options.pool);
+        free_dictionary(&dict);
+        return 1;
+    }
 
-    // Reconstruire l'arbre de Huffman
-    root = build_huffman_tree(freq_table);
+    // Vérifier et créer le nom du fichier de sortie, puis l'ouvrir
+    if (to_stdout)
+        output = stdout;
+    else
+    {
+        output = output_filename ? fopen(output_filename, "wb") : NULL;
+        if (!output)
+        {
+            fprintf(stderr, "Impossible de créer le fichier de sortie\n");
+            cleanup_decompress(output_filename, input, NULL);
+            pool_destroy(options.pool);
+            free_dictionary(&dict);
+            return 1;
+        }
+    }
+    decoded = open_output(output);
 
-    // Décoder le fichier
-    decode_file(input, output, root, freq_table->total_characters);
+    ok = decoded && decode_input(input, decoded, &options);
+    ok = close_output(decoded) && ok;
+    // Mesures demandées par --stats, sur la sortie d'erreur même en mode flux
+    if (stats_format)
+    {
+        huff_stats_enable(NULL);
+        print_stats(stderr, &stats, "decompress", stats_format);
+    }
 
     // Nettoyage
-    cleanup_decompress(output_filename, freq_table, root, input, output);
-    printf("Fichier décompressé avec succès!\n");
+    pool_destroy(options.pool);
+    free_dictionary(&dict);
+    if (input == stdin)
+        input = NULL;
+    if (output == stdout)
+    {
+        fflush(stdout);
+        output = NULL;
+    }
+    // Comme pour la sortie projetée, aucun fichier partiel ne reste après un échec
+    if (!ok && output)
+        unlink(output_filename);
+    cleanup_decompress(output_filename, input, output);
+    if (!ok)
+    {
+        fprintf(stderr, "Erreur : fichier compressé invalide ou tronqué\n");
+        return 1;
+    }
+    if (!to_stdout)
+        printf("Fichier décompressé avec succès!\n");
 	
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,222 @@
+#include "../includes/huffman.h"
+
+/* Identifiant d'une table : empreinte FNV-1a de ses longueurs de codes. Deux
+tables identiques ont le même identifiant, et un fichier compressé avec une
+autre table est reconnu avant d'être décodé */
+uint32_t	dictionary_id(const uint8_t *lengths)
+{
+	uint32_t	hash;
+
+	hash = 2166136261u;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		hash ^= lengths[i];
+		hash *= 16777619u;
+	}
+	return (hash);
+}
+
+/* Construit les codes de l'encodeur et la table du décodeur à partir des
+longueurs déjà placées dans dict->lengths. Chaque octet doit avoir un code */
+bool	prepare_dictionary(HuffDictionary *dict)
+{
+	dict->id = dictionary_id(dict->lengths);
+	dict->max_length = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (dict->lengths[i] == 0)
+			return (false);
+		if (dict->lengths[i] > dict->max_length)
+			dict->max_length = dict->lengths[i];
+	}
+	dict->codes = generate_canonical_codes(dict->lengths, NULL);
+	dict->table = build_canonical_decode_table(dict->lengths, NULL);
+	if (!dict->codes || !dict->table)
+	{
+		free_dictionary(dict);
+		return (false);
+	}
+	return (true);
+}
+
+void	free_dictionary(HuffDictionary *dict)
+{
+	free_huffman_table(dict->codes);
+	free(dict->table);
+	dict->codes = NULL;
+	dict->table = NULL;
+}
+
+/* Entraîne une table sur les fréquences cumulées d'un corpus. Chaque octet
+reçoit un code, même absent du corpus, pour que tout message reste
+encodable ; les longueurs sont bornées par max_length */
+bool	train_dictionary(const uint64_t *frequencies, int max_length, HuffDictionary *dict)
+{
+	FrequencyTable	freq_table;
+	EncodeOptions	options;
+	uint64_t		smoothed[MAX_SYMBOLS];
+
+	freq_table.frequencies = smoothed;
+	freq_table.total_symbols = MAX_SYMBOLS;
+	freq_table.total_characters = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		smoothed[i] = frequencies[i] + 1;
+		freq_table.total_characters += smoothed[i];
+	}
+	options.max_code_length = max_length;
+	options.context_order = 0;
+	choose_code_lengths(&freq_table, &options, dict->lengths);
+	return (prepare_dictionary(dict));
+}
+
+/* Fichier de table : signature HUFF_DICT_MAGIC, identifiant sur 32 bits puis
+longueurs des codes au format compact des blocs */
+bool	save_dictionary(const HuffDictionary *dict, const char *path)
+{
+	unsigned char	lengths[CODE_LENGTHS_MAX_SIZE];
+	size_t			size;
+	FILE			*file;
+	bool			ok;
+
+	file = fopen(path, "wb");
+	if (!file)
+		return (false);
+	size = write_code_lengths(lengths, dict->lengths);
+	ok = fwrite(HUFF_DICT_MAGIC, 1, 4, file) == 4
+		&& fwrite(&dict->id, sizeof(dict->id), 1, file) == 1
+		&& fwrite(lengths, 1, size, file) == size;
+	return (fclose(file) == 0 && ok);
+}
+
+// Relit un fichier de table ; l'identifiant doit correspondre aux longueurs
+bool	load_dictionary(const char *path, HuffDictionary *dict)
+{
+	InputBuffer	*input;
+	uint32_t	id;
+	bool		ok;
+
+	memset(dict, 0, sizeof(HuffDictionary));
+	input = open_input(path);
+	if (!input)
+		return (false);
+	ok = input->size > 4 + sizeof(id) && memcmp(input->data, HUFF_DICT_MAGIC, 4) == 0;
+	if (ok)
+	{
+		memcpy(&id, input->data + 4, sizeof(id));
+		ok = read_code_lengths(input->data + 4 + sizeof(id), input->size - 4 - sizeof(id),
+				dict->lengths) > 0
+			&& prepare_dictionary(dict) && dict->id == id;
+	}
+	close_input(input);
+	if (!ok)
+		free_dictionary(dict);
+	return (ok);
+}
+
+/* Taille maximale du résultat de huff_compress_dict : en-tête, size codes
+d'au plus max_length bits et un mot de 64 bits de marge pour l'écriture */
+size_t	huff_compress_dict_bound(const HuffDictionary *dict, size_t size)
+{
+	return (HUFF_DICT_HEADER_SIZE + (size * dict->max_length + 7) / 8 + sizeof(uint64_t));
+}
+
+// En-tête d'un fichier compressé avec une table : signature, identifiant, taille
+static void	put_dict_header(unsigned char *dst, uint32_t id, uint64_t total)
+{
+	memcpy(dst, HUFF_MAGIC, 3);
+	dst[3] = HUFF_VERSION_DICT;
+	memcpy(dst + 4, &id, sizeof(id));
+	memcpy(dst + 4 + sizeof(id), &total, sizeof(total));
+}
+
+/* Compresse src avec une table partagée : seul un en-tête de
+HUFF_DICT_HEADER_SIZE octets précède les codes. dst doit contenir au moins
+huff_compress_dict_bound(dict, src_size) octets */
+int	huff_compress_dict(const HuffDictionary *dict, const void *src, size_t src_size,
+	void *dst, size_t *dst_size)
+{
+	BitWriter	writer;
+
+	if (*dst_size < huff_compress_dict_bound(dict, src_size))
+		return (HUFF_ERROR_DST_SIZE);
+	put_dict_header(dst, dict->id, src_size);
+	writer.dst = dst;
+	writer.pos = HUFF_DICT_HEADER_SIZE;
+	writer.bits = 0;
+	writer.count = 0;
+	encode_symbols(&writer, src, src_size, dict->codes);
+	flush_bits(&writer);
+	*dst_size = writer.pos;
+	return (HUFF_OK);
+}
+
+/* Lit l'en-tête d'un fichier compressé avec une table. Renvoie HUFF_OK si
+l'identifiant est celui de dict */
+int	read_dict_header(const HuffDictionary *dict, const unsigned char *src, size_t src_size,
+	uint64_t *total)
+{
+	uint32_t	id;
+
+	if (src_size < HUFF_DICT_HEADER_SIZE || memcmp(src, HUFF_MAGIC, 3) != 0
+		|| src[3] != HUFF_VERSION_DICT)
+		return (HUFF_ERROR_CORRUPT);
+	memcpy(&id, src + 4, sizeof(id));
+	memcpy(total, src + 4 + sizeof(id), sizeof(*total));
+	return (id == dict->id ? HUFF_OK : HUFF_ERROR_DICTIONARY);
+}
+
+int	huff_decompress_dict(const HuffDictionary *dict, const void *src, size_t src_size,
+	void *dst, size_t *dst_size)
+{
+	uint64_t	total;
+	int			status;
+
+	status = read_dict_header(dict, src, src_size, &total);
+	if (status != HUFF_OK)
+		return (status);
+	if (total > *dst_size)
+		return (HUFF_ERROR_DST_SIZE);
+	if (!decode_block((const unsigned char *)src + HUFF_DICT_HEADER_SIZE,
+			src_size - HUFF_DICT_HEADER_SIZE, dst, total, dict->table))
+		return (HUFF_ERROR_CORRUPT);
+	*dst_size = total;
+	return (HUFF_OK);
+}
+
+/* Compresse un contenu en mémoire avec une table vers une sortie bufferisée,
+HUFF_BLOCK_SIZE octets à la fois : l'accumulateur de bits est gardé d'un
+morceau à l'autre, le flux de codes est donc continu */
+bool	write_dictionary_file(const HuffDictionary *dict, const unsigned char *data, size_t size,
+	OutputBuffer *output, bool *seen)
+{
+	unsigned char	header[HUFF_DICT_HEADER_SIZE];
+	BitWriter		writer;
+	size_t			chunk;
+	uint64_t		start;
+
+	writer.dst = malloc(huff_compress_dict_bound(dict, HUFF_BLOCK_SIZE));
+	if (!writer.dst)
+		return (false);
+	writer.pos = 0;
+	writer.bits = 0;
+	writer.count = 0;
+	put_dict_header(header, dict->id, size);
+	write_output(output, header, sizeof(header));
+	stats_code_lengths(dict->lengths);
+	for (size_t offset = 0; offset < size; offset += chunk)
+	{
+		chunk = size - offset < HUFF_BLOCK_SIZE ? size - offset : HUFF_BLOCK_SIZE;
+		for (size_t i = 0; i < chunk; i++)
+			seen[data[offset + i]] = true;
+		start = stats_start();
+		encode_symbols(&writer, data + offset, chunk, dict->codes);
+		stats_stop(STAT_ENCODE, start);
+		write_output(output, writer.dst, writer.pos);
+		writer.pos = 0;
+	}
+	flush_bits(&writer);
+	write_output(output, writer.dst, writer.pos);
+	free(writer.dst);
+	return (!output->error);
+}
@@ -0,0 +1,561 @@
+#include "../includes/huffman.h"
+#include <math.h>
+
+// Nettoie la table de Huffman (les codes sont stockés dans la table elle-même)
+void free_huffman_table(HuffmanTable *table) 
+{
+	free(table);
+}
+
+void	free_frequency_table(FrequencyTable *table)
+{
+	if (!table)
+		return;
+	free(table->frequencies);
+	free(table);
+}
+
+/* Table des fréquences de data, prise dans arena avec son tableau de
+compteurs (NULL : sur le tas, libérée par free_frequency_table) */
+FrequencyTable	*count_frequencies(const unsigned char *data, size_t size, HuffArena *arena)
+{
+	FrequencyTable	*table;
+
+	table = arena_alloc(arena, sizeof(FrequencyTable));
+	if (!table)
+		return (NULL);
+	table->frequencies = arena_alloc(arena, MAX_SYMBOLS * sizeof(uint64_t));
+	if (!table->frequencies)
+	{
+		if (!arena)
+			free(table);
+		return (NULL);
+	}
+	table->total_symbols = 0;
+	table->total_characters = size;
+
+	// Compte les fréquences sur le contenu déjà chargé en mémoire
+	count_histogram(data, size, table->frequencies);
+
+	// Le nombre de symboles uniques
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (table->frequencies[i] > 0)
+			table->total_symbols++;
+
+	return (table);
+}
+
+/* Ramène les fréquences sous 2^32 en gardant leurs proportions : l'arbre
+construit reste alors moins profond que MAX_CODE_LENGTH. Un symbole présent
+garde une fréquence d'au moins 1. Sans effet sur les entrées de moins de 4 Gio */
+void	normalize_frequencies(FrequencyTable *table)
+{
+	int	shift;
+
+	shift = 0;
+	while ((table->total_characters >> shift) > UINT32_MAX - MAX_SYMBOLS)
+		shift++;
+	if (shift == 0)
+		return;
+	table->total_characters = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (table->frequencies[i] == 0)
+			continue;
+		table->frequencies[i] >>= shift;
+		if (table->frequencies[i] == 0)
+			table->frequencies[i] = 1;
+		table->total_characters += table->frequencies[i];
+	}
+}
+
+/* Entropie de la table en bits : aucun code préfixe ne code ces symboles en
+moins de bits, c'est donc une borne basse de la taille codée */
+uint64_t	entropy_bits(const FrequencyTable *table)
+{
+	double	bits;
+	double	total;
+
+	bits = 0;
+	total = table->total_characters;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (table->frequencies[i] > 0)
+			bits += table->frequencies[i] * log2(total / table->frequencies[i]);
+	return ((uint64_t)bits);
+}
+
+// Taille exacte des codes en bits, une fois les longueurs choisies
+uint64_t	coded_bits(const FrequencyTable *table, const uint8_t *lengths)
+{
+	uint64_t	bits;
+
+	bits = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		bits += table->frequencies[i] * lengths[i];
+	return (bits);
+}
+
+/* Longueurs des codes canoniques d'une table de fréquences : arbre de Huffman,
+puis package-merge si l'arbre dépasse options->max_code_length */
+void	choose_code_lengths(FrequencyTable *freq_table, const EncodeOptions *options, uint8_t *lengths)
+{
+	HuffmanTree	tree;
+
+	normalize_frequencies(freq_table);
+	build_huffman_tree(freq_table, &tree);
+	compute_code_lengths(&tree, lengths);
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+	{
+		if (lengths[i] > options->max_code_length)
+		{
+			limit_code_lengths(freq_table->frequencies, options->max_code_length, lengths);
+			return;
+		}
+	}
+}
+
+// Bloc stocké : marque STORED_BLOCK puis les octets bruts, décodés par simple copie
+static size_t	store_block(const unsigned char *data, size_t size, unsigned char *dst)
+{
+	stats_count(STAT_STORED_BLOCKS, 1);
+	dst[0] = STORED_BLOCK;
+	memcpy(dst + 1, data, size);
+	return (size + 1);
+}
+
+// Range un mot de 64 bits dans le bloc de sortie, poids fort en premier
+static inline void	store_word(BitWriter *writer, uint64_t word)
+{
+	for (int i = 0; i < 8; i++)
+		writer->dst[writer->pos + i] = word >> (56 - 8 * i);
+	writer->pos += 8;
+}
+
+/* Ajoute un code en un seul décalage/OU dans l'accumulateur ; quand le mot est
+plein, il part dans le bloc et les bits en trop restent dans l'accumulateur */
+static inline void	put_code(BitWriter *writer, uint64_t code, uint32_t length)
+{
+	uint32_t	space;
+	uint32_t	rest;
+
+	space = 64 - writer->count;
+	if (length < space)
+	{
+		writer->bits = (writer->bits << length) | code;
+		writer->count += length;
+		return;
+	}
+	rest = length - space;
+	if (writer->count)
+		store_word(writer, (writer->bits << space) | (code >> rest));
+	else
+		store_word(writer, code >> rest);
+	writer->bits = rest ? code & ((1ULL << rest) - 1) : 0;
+	writer->count = rest;
+}
+
+// Écrit les bits restants complétés par des zéros
+void	flush_bits(BitWriter *writer)
+{
+	while (writer->count >= 8)
+	{
+		writer->dst[writer->pos++] = writer->bits >> (writer->count - 8);
+		writer->count -= 8;
+	}
+	if (writer->count > 0)
+		writer->dst[writer->pos++] = writer->bits << (8 - writer->count);
+	writer->count = 0;
+}
+
+/* Ajoute les codes de size symboles à writer, sans vider l'accumulateur :
+un encodage peut donc se poursuivre sur plusieurs appels. writer->dst doit
+avoir la place pour size codes plus un mot de 64 bits. Le gros des symboles
+passe par le noyau de la longueur maximale de la table, la fin par put_code */
+void	encode_symbols(BitWriter *writer, const unsigned char *data, size_t size, const HuffmanTable *codes)
+{
+	EncodeKernel	kernel;
+	size_t			i;
+
+	kernel = encode_kernel(codes->max_length);
+	i = kernel ? kernel(writer, data, size, codes->codes) : 0;
+	for (; i < size; i++)
+		put_code(writer, codes->codes[data[i]].code, codes->codes[data[i]].length);
+}
+
+/* Même chose avec une table par contexte : le code de chaque octet est pris
+dans la table de l'octet qui le précède, le premier dans la table 0 */
+void	encode_context_symbols(BitWriter *writer, const unsigned char *data, size_t size,
+	HuffmanTable *const *codes)
+{
+	unsigned char	previous;
+
+	previous = 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		put_code(writer, codes[previous]->codes[data[i]].code, codes[previous]->codes[data[i]].length);
+		previous = data[i];
+	}
+}
+
+/* Répartit les codes en SPLIT_STREAMS flux, un par segment consécutif du
+bloc, chacun complété à l'octet. La taille des premiers flux est écrite
+avant eux : le décodeur trouve ainsi le début de chaque flux */
+static void	encode_split_streams(BitWriter *writer, const unsigned char *data, size_t size,
+	const HuffmanTable *codes)
+{
+	uint32_t	sizes[SPLIT_STREAMS - 1];
+	size_t		jump, start, offset;
+
+	jump = writer->pos;
+	writer->pos += sizeof(sizes);
+	offset = 0;
+	for (int k = 0; k < SPLIT_STREAMS; k++)
+	{
+		start = writer->pos;
+		encode_symbols(writer, data + offset, split_segment(size, k), codes);
+		flush_bits(writer);
+		if (k < SPLIT_STREAMS - 1)
+			sizes[k] = writer->pos - start;
+		offset += split_segment(size, k);
+	}
+	memcpy(writer->dst + jump, sizes, sizeof(sizes));
+}
+
+/* Compresse un bloc avec sa propre table : longueurs des codes canoniques puis
+données codées. Un bloc qui ne gagnerait rien est stocké tel quel. L'entropie
+plus la plus petite table de longueurs pour ses symboles borne la taille
+codée par en dessous :
+si le gain promis est inférieur à 1/STORE_ENTROPY_MARGIN du bloc (données
+aléatoires ou déjà compressées), le bloc est stocké sans construire d'arbre.
+Sinon la taille exacte, connue dès les longueurs choisies, écarte les autres
+avant la boucle de codage. Avec options->context_order à 1,
+le bloc est codé avec une table par octet précédent si c'est plus court.
+À partir de SPLIT_MIN_BLOCK octets, les codes sont répartis en flux
+indépendants (SPLIT_BLOCK) pour accélérer le décodage.
+dst doit contenir HUFF_BLOCK_BOUND(size) octets. Les symboles rencontrés sont
+ajoutés à seen. Les tables du bloc sont prises dans arena, sans rien
+libérer : l'appelant la remet à zéro avant le bloc suivant.
+Renvoie la taille écrite, 0 en cas d'erreur */
+size_t	encode_block(const unsigned char *data, size_t size, unsigned char *dst, bool *seen,
+	const EncodeOptions *options, HuffArena *arena)
+{
+	FrequencyTable	*freq_table;
+	HuffmanTable	*codes;
+	uint8_t			lengths[MAX_SYMBOLS];
+	unsigned char	header[CODE_LENGTHS_MAX_SIZE];
+	size_t			header_size, packed_size, context_size;
+	uint64_t		bits, start;
+	BitWriter		writer;
+	bool			split;
+
+	// Phase 1: Analyse des fréquences des caractères
+	stats_count(STAT_BLOCKS, 1);
+	start = stats_start();
+	freq_table = count_frequencies(data, size, arena);
+	stats_stop(STAT_HISTOGRAM, start);
+	if (!freq_table)
+		return (0);
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (freq_table->frequencies[i] > 0)
+			seen[i] = true;
+	// L'entropie d'ordre 0 ne borne pas le coût des codes par contexte
+	if (options->context_order == 0
+		&& entropy_bits(freq_table) / 8 + code_lengths_min_size(freq_table->total_symbols)
+			+ size / STORE_ENTROPY_MARGIN >= size)
+		return (store_block(data, size, dst));
+
+	// Phase 2: Construction de l'arbre de Huffman et génération des codes
+	// Seules les longueurs sont gardées : les codes sont rendus canoniques
+	start = stats_start();
+	choose_code_lengths(freq_table, options, lengths);
+	header_size = write_code_lengths(header, lengths);
+	bits = coded_bits(freq_table, lengths);
+	packed_size = header_size + (bits + 7) / 8;
+	stats_stop(STAT_TREE, start);
+	// Flux multiples : marque, tailles des flux et un octet de bourrage par flux au plus
+	split = size >= SPLIT_MIN_BLOCK;
+	if (split)
+		packed_size += 1 + (SPLIT_STREAMS - 1) * sizeof(uint32_t) + SPLIT_STREAMS - 1;
+	if (packed_size > size + 1)
+		packed_size = size + 1;
+	// Une table par contexte, gardée seulement si elle bat les deux autres formes
+	if (options->context_order == 1)
+	{
+		start = stats_start();
+		context_size = encode_context_block(data, size, dst, options, packed_size, arena);
+		stats_stop(STAT_ENCODE, start);
+		if (context_size > 0)
+			return (context_size);
+	}
+	if (packed_size == size + 1)
+		return (store_block(data, size, dst));
+	start = stats_start();
+	codes = generate_canonical_codes(lengths, arena);
+	stats_stop(STAT_CODES, start);
+	if (!codes)
+		return (0);
+	stats_code_lengths(lengths);
+	stats_count(STAT_CODED_BYTES, size);
+	stats_count(STAT_CODED_BITS, bits);
+
+	// Phase 3: Écrire les longueurs puis les codes, un mot de 64 bits à la fois
+	start = stats_start();
+	writer.dst = dst;
+	writer.pos = 0;
+	writer.bits = 0;
+	writer.count = 0;
+	if (split)
+		dst[writer.pos++] = SPLIT_BLOCK;
+	memcpy(dst + writer.pos, header, header_size);
+	writer.pos += header_size;
+	if (split)
+		encode_split_streams(&writer, data, size, codes);
+	else
+	{
+		encode_symbols(&writer, data, size, codes);
+		flush_bits(&writer);
+	}
+	stats_stop(STAT_ENCODE, start);
+	return (writer.pos);
+}
+
+/* Ajoute après le contenu d'un bloc (packed_size octets dans packed) le
+CRC32C de ses size octets décodés. Le buffer de HUFF_BLOCK_BOUND(size)
+octets a toujours la place : un contenu ne dépasse pas size + 1 octets.
+Renvoie la nouvelle taille du contenu, 0 si le bloc n'a pas été compressé */
+size_t	append_checksum(const unsigned char *data, size_t size, unsigned char *packed, size_t packed_size)
+{
+	uint32_t	crc;
+
+	if (packed_size == 0)
+		return (0);
+	crc = crc32c(data, size);
+	memcpy(packed + packed_size, &crc, CHECKSUM_SIZE);
+	return (packed_size + CHECKSUM_SIZE);
+}
+
+/* Tâche parallèle : compresse le bloc index du lot, dans l'arène de la
+tâche remise à zéro */
+static void	encode_job(void *context, size_t index)
+{
+	BlockJob	*job;
+
+	job = (BlockJob *)context + index;
+	memset(job->seen, 0, sizeof(job->seen));
+	huff_arena_reset(&job->arena);
+	job->packed_size = encode_block(job->raw, job->raw_size, job->packed, job->seen, job->options,
+			&job->arena);
+	job->packed_size = append_checksum(job->raw, job->raw_size, job->packed, job->packed_size);
+	job->ok = job->packed_size > 0;
+}
+
+/* Note la position du bloc suivant dans l'index, puis avance les positions
+décodée et compressée. Sans index (NULL), ne fait rien */
+static bool	add_index_entry(BlockIndex *index, size_t raw_size, size_t packed_size)
+{
+	IndexEntry	*grown;
+
+	if (!index)
+		return (true);
+	if (index->count == index->capacity)
+	{
+		grown = realloc(index->entries, (index->capacity * 2 + 64) * sizeof(IndexEntry));
+		if (!grown)
+			return (false);
+		index->entries = grown;
+		index->capacity = index->capacity * 2 + 64;
+	}
+	index->entries[index->count].raw_offset = index->raw_offset;
+	index->entries[index->count].packed_offset = index->packed_offset;
+	index->count++;
+	index->raw_offset += raw_size;
+	index->packed_offset += 2 * sizeof(uint32_t) + packed_size;
+	return (true);
+}
+
+/* Compresse un lot de blocs en parallèle puis les écrit dans l'ordre. Chaque
+bloc est précédé de sa taille décodée et de sa taille compressée (32 bits) */
+static bool	write_batch(OutputBuffer *output, BlockJob *jobs, size_t count, ThreadPool *pool, bool *seen,
+	BlockIndex *index)
+{
+	uint32_t	header[2];
+
+	pool_run(pool, count, encode_job, jobs);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!jobs[i].ok || !add_index_entry(index, jobs[i].raw_size, jobs[i].packed_size))
+			return (false);
+		header[0] = jobs[i].raw_size;
+		header[1] = jobs[i].packed_size;
+		write_output(output, header, sizeof(header));
+		write_output(output, jobs[i].packed, jobs[i].packed_size);
+		for (int c = 0; c < MAX_SYMBOLS; c++)
+			seen[c] |= jobs[i].seen[c];
+	}
+	return (!output->error);
+}
+
+void	free_jobs(BlockJob *jobs, size_t batch)
+{
+	for (size_t i = 0; i < batch; i++)
+	{
+		if (jobs[i].raw_capacity)
+			free(jobs[i].raw);
+		free(jobs[i].packed);
+		huff_arena_free(&jobs[i].arena);
+	}
+	free(jobs);
+}
+
+/* Prépare un lot de quelques blocs par thread ; chaque bloc a son buffer de
+sortie de HUFF_BLOCK_BOUND(HUFF_BLOCK_SIZE) octets, et son propre buffer
+d'entrée si own_input est vrai */
+BlockJob	*create_jobs(size_t batch, bool own_input, const EncodeOptions *options)
+{
+	BlockJob	*jobs;
+
+	jobs = calloc(batch, sizeof(BlockJob));
+	if (!jobs)
+		return (NULL);
+	for (size_t i = 0; i < batch; i++)
+	{
+		jobs[i].options = options;
+		if (!reserve_buffer(&jobs[i].packed, &jobs[i].packed_capacity, HUFF_BLOCK_BOUND(HUFF_BLOCK_SIZE))
+			|| (own_input && !reserve_buffer(&jobs[i].raw, &jobs[i].raw_capacity, HUFF_BLOCK_SIZE)))
+		{
+			free_jobs(jobs, batch);
+			return (NULL);
+		}
+	}
+	return (jobs);
+}
+
+/* Signature en tête de fichier, puis bloc vide (0 0) à la fin suivi de la
+taille décodée totale sur 64 bits, que le décodeur compare à la somme des blocs */
+static void	write_file_header(OutputBuffer *output)
+{
+	write_output(output, HUFF_MAGIC, 3);
+	output_byte(output, HUFF_VERSION_CHECKED);
+}
+
+/* Index facultatif après la taille totale : une entrée par bloc (position
+décodée puis position de son en-tête dans le fichier, 64 bits chacune), le
+nombre d'entrées sur 64 bits et la signature HUFF_INDEX_MAGIC. Il se lit en
+partant de la fin du fichier ; les décodeurs qui l'ignorent s'arrêtent avant */
+static bool	write_end_marker(OutputBuffer *output, uint64_t total, BlockIndex *index)
+{
+	uint32_t	end[2] = {0, 0};
+	uint64_t	count;
+
+	write_output(output, end, sizeof(end));
+	write_output(output, &total, sizeof(total));
+	if (index)
+	{
+		count = index->count;
+		write_output(output, index->entries, index->count * sizeof(IndexEntry));
+		write_output(output, &count, sizeof(count));
+		write_output(output, HUFF_INDEX_MAGIC, 4);
+	}
+	return (!output->error);
+}
+
+// Index vide, positionné sur le premier bloc qui suit la signature
+static BlockIndex	*start_index(BlockIndex *index, const EncodeOptions *options)
+{
+	if (!options->write_index)
+		return (NULL);
+	memset(index, 0, sizeof(BlockIndex));
+	index->packed_offset = 4;
+	return (index);
+}
+
+/* Compresse un contenu déjà en mémoire avec des blocs préparés par
+create_jobs (sans buffer d'entrée), batch blocs à la fois. Les blocs
+pointent directement dans data, sans copie. Les buffers de sortie ne sont
+pas libérés : le mode lot les garde d'un fichier à l'autre */
+bool	write_compressed_jobs(const unsigned char *data, size_t size, OutputBuffer *output, bool *seen,
+	ThreadPool *pool, BlockJob *jobs, size_t batch)
+{
+	BlockIndex	storage, *index;
+	size_t		count, offset, chunk;
+	bool		ok;
+
+	write_file_header(output);
+	index = start_index(&storage, jobs[0].options);
+	ok = true;
+	offset = 0;
+	while (ok && offset < size)
+	{
+		for (count = 0; count < batch && offset < size; count++, offset += chunk)
+		{
+			chunk = size - offset < HUFF_BLOCK_SIZE ? size - offset : HUFF_BLOCK_SIZE;
+			jobs[count].raw = (unsigned char *)data + offset;
+			jobs[count].raw_size = chunk;
+		}
+		ok = write_batch(output, jobs, count, pool, seen, index);
+	}
+	ok = ok && write_end_marker(output, size, index);
+	if (index)
+		free(index->entries);
+	return (ok);
+}
+
+// Compresse un contenu déjà en mémoire, découpé en blocs de HUFF_BLOCK_SIZE
+bool	write_compressed_file(const unsigned char *data, size_t size, OutputBuffer *output, bool *seen,
+	ThreadPool *pool, const EncodeOptions *options)
+{
+	BlockJob	*jobs;
+	size_t		batch;
+	bool		ok;
+
+	batch = (pool ? pool->thread_count : 1) * BLOCKS_PER_THREAD;
+	jobs = create_jobs(batch, false, options);
+	if (!jobs)
+		return (false);
+	ok = write_compressed_jobs(data, size, output, seen, pool, jobs, batch);
+	free_jobs(jobs, batch);
+	return (ok);
+}
+
+/* Compresse un flux non positionnable (stdin) : un lot de blocs est lu,
+compressé et écrit avant de lire le suivant, la mémoire reste donc bornée */
+bool write_compressed_stream(FILE *input, OutputBuffer *output, bool *seen, ThreadPool *pool,
+	const EncodeOptions *options)
+{
+	BlockJob	*jobs;
+	BlockIndex	storage, *index;
+	size_t		batch, count, size;
+	uint64_t	total, start;
+	bool		ok, more;
+
+	batch = (pool ? pool->thread_count : 1) * BLOCKS_PER_THREAD;
+	jobs = create_jobs(batch, true, options);
+	if (!jobs)
+		return (false);
+	write_file_header(output);
+	index = start_index(&storage, options);
+	ok = true;
+	more = true;
+	total = 0;
+	while (ok && more)
+	{
+		count = 0;
+		start = stats_start();
+		while (count < batch && (size = fread(jobs[count].raw, 1, HUFF_BLOCK_SIZE, input)) > 0)
+		{
+			jobs[count++].raw_size = size;
+			total += size;
+			stats_count(STAT_READ_CALLS, 1);
+			stats_count(STAT_BYTES_IN, size);
+		}
+		stats_stop(STAT_READ, start);
+		more = count == batch;
+		ok = write_batch(output, jobs, count, pool, seen, index);
+	}
+	ok = ok && !ferror(input);
+	free_jobs(jobs, batch);
+	ok = ok && write_end_marker(output, total, index);
+	if (index)
+		free(index->entries);
+	return (ok);
+}
@@ -0,0 +1,222 @@
+#include "../includes/huffman.h"
+
+/* Harnais de fuzzing des décodeurs : chaque entrée passe par tous les
+chemins qui lisent des données non fiables (décompression en mémoire, accès
+à une plage, flux par morceaux, décodage d'un FILE de n'importe quelle
+version). Compilé avec -DHUFF_LIBFUZZER, seul LLVMFuzzerTestOneInput est
+fourni à libFuzzer ; sinon main mute elle-même les graines données en
+arguments. Un défaut mémoire est signalé par les sanitizers */
+
+// Taille décodée maximale acceptée pour une entrée, pour rester rapide
+#define FUZZ_MAX_OUTPUT (16 << 20)
+// Entrées mutées par graine (-n)
+#define FUZZ_ITERATIONS 2000
+// Taille de la fenêtre de sortie du flux et de la plage décodée
+#define FUZZ_WINDOW 4096
+
+static HuffDictionary	g_dict;
+static unsigned char	g_output[FUZZ_MAX_OUTPUT];
+
+// Bibliothèque : taille annoncée, décompression complète puis une plage
+static void	fuzz_buffer(const unsigned char *data, size_t size)
+{
+	uint64_t	total;
+	size_t		capacity;
+
+	total = 0;
+	huff_decompressed_size(data, size, &total);
+	capacity = total < FUZZ_MAX_OUTPUT ? total : FUZZ_MAX_OUTPUT;
+	huff_decompress(data, size, g_output, &capacity);
+	capacity = FUZZ_WINDOW;
+	huff_decompress_range(data, size, total > 0 ? size * 2654435761u % total : 0, g_output, &capacity);
+}
+
+/* Flux : l'entrée est poussée par morceaux de taille variable, la sortie
+lue par fenêtres de FUZZ_WINDOW octets, jusqu'à FUZZ_MAX_OUTPUT octets */
+static void	fuzz_stream(const unsigned char *data, size_t size)
+{
+	HuffStream	stream;
+	size_t		pos, step, in, out, produced;
+	int			status;
+
+	if (huff_stream_init(&stream, HUFF_STREAM_DECOMPRESS) != HUFF_OK)
+		return;
+	pos = 0;
+	produced = 0;
+	status = HUFF_OK;
+	step = 1 + size % 997;
+	while (status == HUFF_OK && pos < size && produced < FUZZ_MAX_OUTPUT)
+	{
+		in = size - pos < step ? size - pos : step;
+		out = FUZZ_WINDOW;
+		status = huff_stream_update(&stream, data + pos, &in, g_output, &out);
+		if (in == 0 && out == 0)
+			break;
+		pos += in;
+		produced += out;
+	}
+	while (status == HUFF_OK && produced < FUZZ_MAX_OUTPUT)
+	{
+		out = FUZZ_WINDOW;
+		status = huff_stream_finish(&stream, g_output, &out);
+		produced += out;
+		if (status == HUFF_MORE)
+			status = HUFF_OK;
+		else
+			break;
+	}
+	huff_stream_free(&stream);
+}
+
+// Décodage d'un FILE comme decompress, la sortie étant jetée
+static void	fuzz_file(const unsigned char *data, size_t size)
+{
+	DecodeOptions	options;
+	OutputBuffer	*discard;
+	FILE			*input;
+
+	if (size == 0)
+		return;
+	input = fmemopen((void *)data, size, "rb");
+	discard = open_output(NULL);
+	options.dict = g_dict.table ? &g_dict : NULL;
+	options.pool = NULL;
+	options.max_output = FUZZ_MAX_OUTPUT;
+	options.verbose = false;
+	if (input && discard)
+		decode_input(input, discard, &options);
+	close_output(discard);
+	if (input)
+		fclose(input);
+}
+
+int	LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	fuzz_buffer(data, size);
+	fuzz_stream(data, size);
+	fuzz_file(data, size);
+	return (0);
+}
+
+#ifndef HUFF_LIBFUZZER
+
+static uint64_t	g_state = 0x9E3779B97F4A7C15u;
+
+// Générateur xorshift : les mutations sont reproductibles à graine égale
+static uint64_t	next_random(void)
+{
+	g_state ^= g_state << 13;
+	g_state ^= g_state >> 7;
+	g_state ^= g_state << 17;
+	return (g_state);
+}
+
+/* Une mutation de data : bit inversé, octet ou entier de 32 bits remplacé
+par une valeur limite (tailles de bloc, marques de bloc), morceau recopié
+ailleurs, version changée ou fin coupée. Renvoie la nouvelle taille */
+static size_t	mutate(unsigned char *data, size_t size)
+{
+	static const uint32_t	words[] = {0, 1, 0xFFFFFFFFu, HUFF_BLOCK_SIZE, HUFF_MAX_BLOCK_SIZE,
+		HUFF_MAX_BLOCK_SIZE + 1, 0x80000000u};
+	static const uint8_t	bytes[] = {0, 1, 0x7F, 0x80, STORED_BLOCK, CONTEXT_BLOCK, SPLIT_BLOCK,
+		MAX_CODE_LENGTH, MAX_CODE_LENGTH + 1};
+	size_t					at, from, length;
+
+	if (size == 0)
+		return (0);
+	at = next_random() % size;
+	switch (next_random() % 7)
+	{
+		case 0:
+			data[at] ^= 1 << (next_random() % 8);
+			break;
+		case 1:
+			data[at] = bytes[next_random() % (sizeof(bytes) / sizeof(bytes[0]))];
+			break;
+		case 2:
+			if (size - at >= sizeof(uint32_t))
+				memcpy(data + at, &words[next_random() % (sizeof(words) / sizeof(words[0]))],
+					sizeof(uint32_t));
+			break;
+		case 3:
+			from = next_random() % size;
+			length = next_random() % 64;
+			if (length > size - at)
+				length = size - at;
+			if (length > size - from)
+				length = size - from;
+			memmove(data + at, data + from, length);
+			break;
+		case 4:
+			if (size >= 4)
+				data[3] = next_random() % (HUFF_VERSION_CHECKED + 2);
+			break;
+		case 5:
+			return (at);
+		default:
+			data[at] = next_random();
+	}
+	return (size);
+}
+
+/* Usage : fuzz_decode [-n itérations] [-s graine] [-D table] fichier.huff...
+Chaque fichier est décodé tel quel, puis -n fois après 1 à 4 mutations */
+int	main(int argc, char **argv)
+{
+	InputBuffer		*seed;
+	unsigned char	*data;
+	size_t			size;
+	long			iterations;
+	int				opt;
+
+	iterations = FUZZ_ITERATIONS;
+	while ((opt = getopt(argc, argv, "n:s:D:")) != -1)
+	{
+		if (opt == 'n')
+			iterations = atol(optarg);
+		else if (opt == 's')
+			g_state = strtoull(optarg, NULL, 0) | 1;
+		else if (opt == 'D')
+		{
+			if (!load_dictionary(optarg, &g_dict))
+			{
+				fprintf(stderr, "%s : table invalide ou illisible\n", optarg);
+				return (1);
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-n itérations] [-s graine] [-D table] fichier.huff...\n", argv[0]);
+			return (1);
+		}
+	}
+	for (int i = optind; i < argc; i++)
+	{
+		seed = open_input(argv[i]);
+		data = seed ? malloc(seed->size + 1) : NULL;
+		if (!data)
+		{
+			perror(argv[i]);
+			close_input(seed);
+			free_dictionary(&g_dict);
+			return (1);
+		}
+		printf("%s : %zu octets, %ld mutations\n", argv[i], seed->size, iterations);
+		fflush(stdout);
+		LLVMFuzzerTestOneInput(seed->data, seed->size);
+		for (long n = 0; n < iterations; n++)
+		{
+			memcpy(data, seed->data, seed->size);
+			size = seed->size;
+			for (int k = 1 + next_random() % 4; k > 0; k--)
+				size = mutate(data, size);
+			LLVMFuzzerTestOneInput(data, size);
+		}
+		free(data);
+		close_input(seed);
+	}
+	free_dictionary(&g_dict);
+	return (0);
+}
+
+#endif
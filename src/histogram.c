@@ -0,0 +1,90 @@
+#include "../includes/huffman.h"
+
+/* Compte les octets de data dans counts (qui n'est pas remis à zéro).
+Les octets sont lus 8 par 8 et répartis sur HISTOGRAM_WAYS sous-histogrammes :
+deux octets identiques consécutifs n'incrémentent pas le même compteur, ce
+qui évite d'attendre la fin d'une écriture pour relire la même case.
+Les sous-histogrammes sont additionnés tous les HISTOGRAM_SEGMENT octets */
+static void	count_segment(const unsigned char *data, size_t size, uint64_t *counts)
+{
+	uint32_t	sub[HISTOGRAM_WAYS][MAX_SYMBOLS];
+	uint64_t	word;
+	size_t		i;
+
+	memset(sub, 0, sizeof(sub));
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		memcpy(&word, data + i, sizeof(word));
+		sub[0][word & 0xFF]++;
+		sub[1][(word >> 8) & 0xFF]++;
+		sub[2][(word >> 16) & 0xFF]++;
+		sub[3][(word >> 24) & 0xFF]++;
+		sub[0][(word >> 32) & 0xFF]++;
+		sub[1][(word >> 40) & 0xFF]++;
+		sub[2][(word >> 48) & 0xFF]++;
+		sub[3][word >> 56]++;
+	}
+	for (; i < size; i++)
+		sub[0][data[i]]++;
+	for (int c = 0; c < MAX_SYMBOLS; c++)
+		counts[c] += (uint64_t)sub[0][c] + sub[1][c] + sub[2][c] + sub[3][c];
+}
+
+void	count_histogram(const unsigned char *data, size_t size, uint64_t *counts)
+{
+	size_t	chunk;
+
+	while (size > 0)
+	{
+		chunk = size < HISTOGRAM_SEGMENT ? size : HISTOGRAM_SEGMENT;
+		count_segment(data, chunk, counts);
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+typedef struct
+{
+	const unsigned char	*data;
+	size_t				size;
+	size_t				chunk;
+	uint64_t			(*counts)[MAX_SYMBOLS];  // Un histogramme par morceau
+}				HistogramJob;
+
+static void	histogram_job(void *context, size_t index)
+{
+	HistogramJob	*job;
+	size_t			start, size;
+
+	job = context;
+	start = index * job->chunk;
+	size = job->size - start < job->chunk ? job->size - start : job->chunk;
+	count_histogram(job->data + start, size, job->counts[index]);
+}
+
+/* Même résultat que count_histogram, mais une grande entrée est découpée en
+un morceau par thread du groupe ; les histogrammes partiels sont additionnés.
+Ne doit pas être appelée depuis une tâche du même groupe de threads */
+void	count_histogram_parallel(const unsigned char *data, size_t size, uint64_t *counts, ThreadPool *pool)
+{
+	HistogramJob	job;
+	size_t			parts;
+
+	parts = pool ? pool->thread_count : 1;
+	if (size / HISTOGRAM_MIN_CHUNK < parts)
+		parts = size / HISTOGRAM_MIN_CHUNK;
+	job.counts = parts > 1 ? calloc(parts, sizeof(*job.counts)) : NULL;
+	if (!job.counts)
+	{
+		count_histogram(data, size, counts);
+		return;
+	}
+	job.data = data;
+	job.size = size;
+	job.chunk = (size + parts - 1) / parts;
+	pool_run(pool, parts, histogram_job, &job);
+	for (size_t i = 0; i < parts; i++)
+		for (int c = 0; c < MAX_SYMBOLS; c++)
+			counts[c] += job.counts[i][c];
+	free(job.counts);
+}
@@ -0,0 +1,392 @@
+#include "../includes/huffman.h"
+
+/* Taille maximale du résultat de huff_compress pour size octets : signature,
+chaque bloc avec son en-tête, puis le bloc de fin et la taille totale */
+size_t	huff_compress_bound(size_t size)
+{
+	size_t	blocks;
+
+	blocks = (size + HUFF_BLOCK_SIZE - 1) / HUFF_BLOCK_SIZE;
+	return (4 + size + size / 8 + blocks * (2 * sizeof(uint32_t) + CODE_LENGTHS_MAX_SIZE + 8)
+		+ 2 * sizeof(uint32_t) + sizeof(uint64_t));
+}
+
+// Ajoute size octets à dst s'il reste la place
+static bool	put_bytes(unsigned char *dst, size_t capacity, size_t *pos, const void *data, size_t size)
+{
+	if (capacity - *pos < size)
+		return (false);
+	memcpy(dst + *pos, data, size);
+	*pos += size;
+	return (true);
+}
+
+/* Compresse src vers dst dans le même format que l'outil compress, sans
+fichier ni thread. *dst_size donne la place disponible dans dst et reçoit la
+taille écrite. Avec au moins huff_compress_bound(src_size) octets, les blocs
+sont encodés directement dans dst ; sinon chacun passe par un buffer
+intermédiaire et HUFF_ERROR_DST_SIZE est renvoyé s'il ne tient pas */
+int	huff_compress(const void *src, size_t src_size, void *dst, size_t *dst_size)
+{
+	HuffArena	arena;
+	int			status;
+
+	huff_arena_init(&arena, 0);
+	status = huff_compress_arena(src, src_size, dst, dst_size, &arena);
+	huff_arena_free(&arena);
+	return (status);
+}
+
+/* Même chose, les tables de chaque bloc étant prises dans arena. Un thread
+qui garde son arène d'un appel à l'autre ne passe plus par l'allocateur
+une fois la région à la taille du plus gros bloc */
+int	huff_compress_arena(const void *src, size_t src_size, void *dst, size_t *dst_size,
+	HuffArena *arena)
+{
+	EncodeOptions	options;
+	unsigned char	*out, *target, *scratch;
+	size_t			capacity, pos, offset, chunk;
+	uint32_t		header[2];
+	uint64_t		total;
+	unsigned char	version;
+	bool			seen[MAX_SYMBOLS];
+	int				status;
+
+	options.max_code_length = DEFAULT_CODE_LENGTH_LIMIT;
+	options.context_order = 0;
+	options.write_index = false;
+	out = dst;
+	capacity = *dst_size;
+	pos = 0;
+	version = HUFF_VERSION_CHECKED;
+	if (!put_bytes(out, capacity, &pos, HUFF_MAGIC, 3) || !put_bytes(out, capacity, &pos, &version, 1))
+		return (HUFF_ERROR_DST_SIZE);
+	scratch = NULL;
+	status = HUFF_OK;
+	for (offset = 0; status == HUFF_OK && offset < src_size; offset += chunk)
+	{
+		chunk = src_size - offset < HUFF_BLOCK_SIZE ? src_size - offset : HUFF_BLOCK_SIZE;
+		if (capacity - pos >= sizeof(header) + HUFF_BLOCK_BOUND(chunk))
+			target = out + pos + sizeof(header);
+		else
+		{
+			if (!scratch)
+				scratch = malloc(HUFF_BLOCK_BOUND(HUFF_BLOCK_SIZE));
+			target = scratch;
+		}
+		header[0] = chunk;
+		huff_arena_reset(arena);
+		header[1] = target ? encode_block((const unsigned char *)src + offset, chunk, target, seen, &options,
+				arena) : 0;
+		header[1] = append_checksum((const unsigned char *)src + offset, chunk, target, header[1]);
+		if (header[1] == 0)
+			status = HUFF_ERROR_MEMORY;
+		else if (capacity - pos < sizeof(header) + header[1])
+			status = HUFF_ERROR_DST_SIZE;
+		else
+		{
+			put_bytes(out, capacity, &pos, header, sizeof(header));
+			if (target == scratch)
+				memcpy(out + pos, scratch, header[1]);
+			pos += header[1];
+		}
+	}
+	free(scratch);
+	if (status != HUFF_OK)
+		return (status);
+	// Bloc de fin puis taille totale sur 64 bits
+	header[0] = 0;
+	header[1] = 0;
+	total = src_size;
+	if (!put_bytes(out, capacity, &pos, header, sizeof(header))
+		|| !put_bytes(out, capacity, &pos, &total, sizeof(total)))
+		return (HUFF_ERROR_DST_SIZE);
+	*dst_size = pos;
+	return (HUFF_OK);
+}
+
+/* Lit l'en-tête du bloc à la position *pos et vérifie qu'il tient dans src.
+Renvoie 1 pour un bloc, 0 pour le bloc de fin, -1 si src est invalide */
+static int	next_block(const unsigned char *src, size_t size, size_t *pos, uint32_t *header)
+{
+	if (size - *pos < 2 * sizeof(uint32_t))
+		return (-1);
+	memcpy(header, src + *pos, 2 * sizeof(uint32_t));
+	*pos += 2 * sizeof(uint32_t);
+	if (header[0] == 0)
+		return (0);
+	// Un bloc a au moins un octet de contenu (marque ou table)
+	if (header[0] > HUFF_MAX_BLOCK_SIZE || header[1] == 0 || header[1] > HUFF_BLOCK_BOUND(header[0])
+		|| header[1] > size - *pos)
+		return (-1);
+	return (1);
+}
+
+// Vérifie la signature ; renvoie la version, ou -1 si elle n'est pas gérée
+static int	buffer_version(const unsigned char *src, size_t size)
+{
+	if (size < 4 || memcmp(src, HUFF_MAGIC, 3) != 0)
+		return (-1);
+	if (src[3] != HUFF_VERSION_BLOCKS && src[3] != HUFF_VERSION_LARGE && src[3] != HUFF_VERSION_CHECKED)
+		return (-1);
+	return (src[3]);
+}
+
+// Taille décodée de src, calculée à partir des en-têtes de blocs sans décoder
+int	huff_decompressed_size(const void *src, size_t src_size, uint64_t *size)
+{
+	uint32_t	header[2];
+	size_t		pos;
+	int			status;
+
+	if (buffer_version(src, src_size) < 0)
+		return (HUFF_ERROR_CORRUPT);
+	*size = 0;
+	pos = 4;
+	while ((status = next_block(src, src_size, &pos, header)) == 1)
+	{
+		*size += header[0];
+		pos += header[1];
+	}
+	return (status == 0 ? HUFF_OK : HUFF_ERROR_CORRUPT);
+}
+
+/* Décode un lot de blocs déjà repérés dans src, en parallèle sur pool.
+Renvoie false si l'un d'eux est invalide */
+static bool	decode_batch(BlockJob *jobs, size_t count, ThreadPool *pool)
+{
+	pool_run(pool, count, decode_job, jobs);
+	for (size_t i = 0; i < count; i++)
+		if (!jobs[i].ok)
+			return (false);
+	return (true);
+}
+
+/* Décompresse src (versions 2, 3 et 5 du format ; les versions 0, 1 et 4
+sont refusées) vers dst. *dst_size donne la place disponible et reçoit la
+taille décodée */
+int	huff_decompress(const void *src, size_t src_size, void *dst, size_t *dst_size)
+{
+	return (huff_decompress_pool(src, src_size, dst, dst_size, NULL));
+}
+
+/* Décode les blocs de src par lots en parallèle sur pool (NULL : dans le
+thread appelant). Chaque bloc est lu en place dans src et décodé directement
+à sa position dans dst, sans buffer intermédiaire : avec une entrée et une
+sortie projetées en mémoire, aucun octet n'est copié. Chaque tâche d'un lot
+parallèle a sa propre arène ; dans le thread appelant, arena sert à tous
+les blocs */
+static int	decompress_blocks(const void *src, size_t src_size, void *dst, size_t *dst_size,
+	ThreadPool *pool, HuffArena *arena)
+{
+	const unsigned char	*in;
+	BlockJob			single, *jobs;
+	uint32_t			header[2];
+	uint64_t			total;
+	size_t				pos, written, batch, count;
+	int					version, status;
+
+	in = src;
+	version = buffer_version(in, src_size);
+	if (version < 0)
+		return (HUFF_ERROR_CORRUPT);
+	batch = pool && pool->thread_count > 1 ? pool->thread_count * BLOCKS_PER_THREAD : 1;
+	jobs = batch > 1 ? calloc(batch, sizeof(BlockJob)) : &single;
+	if (!jobs)
+		return (HUFF_ERROR_MEMORY);
+	if (jobs == &single)
+		single.arena = *arena;
+	pos = 4;
+	written = 0;
+	status = 1;
+	while (status == 1)
+	{
+		for (count = 0; count < batch && (status = next_block(in, src_size, &pos, header)) == 1; count++)
+		{
+			if (header[0] > *dst_size - written)
+			{
+				status = HUFF_ERROR_DST_SIZE;
+				break;
+			}
+			jobs[count].packed = (unsigned char *)in + pos;
+			jobs[count].packed_size = header[1];
+			jobs[count].raw = (unsigned char *)dst + written;
+			jobs[count].raw_size = header[0];
+			jobs[count].checksum = version == HUFF_VERSION_CHECKED;
+			pos += header[1];
+			written += header[0];
+		}
+		if (!decode_batch(jobs, count, pool) && status >= 0)
+			status = -1;
+	}
+	if (jobs == &single)
+		*arena = single.arena;
+	else
+	{
+		for (size_t i = 0; i < batch; i++)
+			huff_arena_free(&jobs[i].arena);
+		free(jobs);
+	}
+	if (status == HUFF_ERROR_DST_SIZE)
+		return (HUFF_ERROR_DST_SIZE);
+	if (status < 0)
+		return (HUFF_ERROR_CORRUPT);
+	if (version == HUFF_VERSION_LARGE || version == HUFF_VERSION_CHECKED)
+	{
+		if (src_size - pos < sizeof(total))
+			return (HUFF_ERROR_CORRUPT);
+		memcpy(&total, in + pos, sizeof(total));
+		if (total != written)
+			return (HUFF_ERROR_CORRUPT);
+	}
+	*dst_size = written;
+	return (HUFF_OK);
+}
+
+// Décompression sur pool (NULL : dans le thread appelant)
+int	huff_decompress_pool(const void *src, size_t src_size, void *dst, size_t *dst_size,
+	ThreadPool *pool)
+{
+	HuffArena	arena;
+	int			status;
+
+	huff_arena_init(&arena, 0);
+	status = decompress_blocks(src, src_size, dst, dst_size, pool, &arena);
+	huff_arena_free(&arena);
+	return (status);
+}
+
+/* Décompression dans le thread appelant, les tables de chaque bloc étant
+prises dans arena, gardée par l'appelant d'un appel à l'autre */
+int	huff_decompress_arena(const void *src, size_t src_size, void *dst, size_t *dst_size,
+	HuffArena *arena)
+{
+	return (decompress_blocks(src, src_size, dst, dst_size, NULL, arena));
+}
+
+/* Cherche l'index écrit par compress -i à la fin de src. Renvoie le début de
+ses entrées et leur nombre dans *count, ou NULL si src n'en a pas */
+static const unsigned char	*find_index(const unsigned char *src, size_t size, uint64_t *count)
+{
+	size_t	footer;
+
+	footer = sizeof(uint64_t) + 4;
+	if (size < 4 + footer || memcmp(src + size - 4, HUFF_INDEX_MAGIC, 4) != 0)
+		return (NULL);
+	memcpy(count, src + size - footer, sizeof(*count));
+	if (*count == 0 || *count > (size - 4 - footer) / sizeof(IndexEntry))
+		return (NULL);
+	return (src + size - footer - *count * sizeof(IndexEntry));
+}
+
+/* Position de l'en-tête du bloc qui contient l'octet décodé offset ; *start
+reçoit la position décodée du début de ce bloc. Avec un index, recherche
+dichotomique de la dernière entrée qui commence avant offset ; sinon, les
+en-têtes sont parcourus en sautant les données, sans rien décoder */
+static size_t	seek_block(const unsigned char *src, size_t size, uint64_t offset, uint64_t *start)
+{
+	const unsigned char	*entries;
+	IndexEntry			entry;
+	uint64_t			count, low, high, mid;
+	uint32_t			header[2];
+	size_t				pos, block;
+
+	entries = find_index(src, size, &count);
+	if (entries)
+	{
+		low = 0;
+		high = count - 1;
+		while (low < high)
+		{
+			mid = low + (high - low + 1) / 2;
+			memcpy(&entry, entries + mid * sizeof(IndexEntry), sizeof(entry));
+			if (entry.raw_offset <= offset)
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		memcpy(&entry, entries + low * sizeof(IndexEntry), sizeof(entry));
+		if (entry.raw_offset <= offset && entry.packed_offset >= 4 && entry.packed_offset < size)
+		{
+			*start = entry.raw_offset;
+			return (entry.packed_offset);
+		}
+	}
+	*start = 0;
+	pos = 4;
+	while (true)
+	{
+		block = pos;
+		if (next_block(src, size, &pos, header) != 1 || *start + header[0] > offset)
+			return (block);
+		*start += header[0];
+		pos += header[1];
+	}
+}
+
+/* Décompresse seulement les octets décodés offset à offset + *dst_size de src
+vers dst : seuls les blocs qui recouvrent cette plage sont décodés. Un bloc
+entièrement dans la plage est décodé directement dans dst, les blocs des
+bords passent par un buffer intermédiaire. *dst_size reçoit le nombre
+d'octets rendus, plus petit si la plage dépasse la fin des données */
+int	huff_decompress_range(const void *src, size_t src_size, uint64_t offset, void *dst, size_t *dst_size)
+{
+	const unsigned char	*in;
+	unsigned char		*scratch, *target;
+	HuffArena			arena;
+	uint32_t			header[2];
+	uint64_t			start, skip;
+	size_t				pos, written, chunk, capacity;
+	int					status, error;
+
+	in = src;
+	if (buffer_version(in, src_size) < 0)
+		return (HUFF_ERROR_CORRUPT);
+	pos = seek_block(in, src_size, offset, &start);
+	written = 0;
+	scratch = NULL;
+	capacity = 0;
+	huff_arena_init(&arena, 0);
+	status = 0;
+	error = HUFF_OK;
+	while (error == HUFF_OK && written < *dst_size && (status = next_block(in, src_size, &pos, header)) == 1)
+	{
+		skip = offset + written - start;
+		start += header[0];
+		if (skip >= header[0])
+		{
+			pos += header[1];
+			continue;
+		}
+		chunk = header[0] - skip < *dst_size - written ? header[0] - skip : *dst_size - written;
+		target = (unsigned char *)dst + written;
+		if (chunk < header[0])
+		{
+			if (!reserve_buffer(&scratch, &capacity, header[0]))
+			{
+				error = HUFF_ERROR_MEMORY;
+				break;
+			}
+			target = scratch;
+		}
+		huff_arena_reset(&arena);
+		if (!(in[3] == HUFF_VERSION_CHECKED ? decode_checked_block : decode_packed_block)(in + pos,
+				header[1], target, header[0], &arena))
+		{
+			error = HUFF_ERROR_CORRUPT;
+			break;
+		}
+		if (target == scratch)
+			memcpy((unsigned char *)dst + written, scratch + skip, chunk);
+		written += chunk;
+		pos += header[1];
+	}
+	free(scratch);
+	huff_arena_free(&arena);
+	if (error != HUFF_OK)
+		return (error);
+	if (written < *dst_size && status < 0)
+		return (HUFF_ERROR_CORRUPT);
+	*dst_size = written;
+	return (HUFF_OK);
+}
@@ -0,0 +1,218 @@
+#include "../includes/huffman.h"
+
+/* Charge l'entrée par blocs de IO_BLOCK_SIZE quand elle ne peut pas être
+projetée en mémoire (tube, fichier spécial, fichier vide) */
+static bool	read_blocks(int fd, InputBuffer *input)
+{
+	size_t			capacity;
+	ssize_t			got;
+	unsigned char	*grown;
+	uint64_t		start;
+
+	capacity = IO_BLOCK_SIZE;
+	input->data = malloc(capacity);
+	if (!input->data)
+		return (false);
+	input->size = 0;
+	while (1)
+	{
+		if (input->size == capacity)
+		{
+			capacity *= 2;
+			grown = realloc(input->data, capacity);
+			if (!grown)
+				return (false);
+			input->data = grown;
+		}
+		start = stats_start();
+		got = read(fd, input->data + input->size, capacity - input->size > IO_BLOCK_SIZE
+				? IO_BLOCK_SIZE : capacity - input->size);
+		stats_stop(STAT_READ, start);
+		stats_count(STAT_READ_CALLS, 1);
+		if (got < 0)
+			return (false);
+		if (got == 0)
+			return (true);
+		input->size += got;
+		stats_count(STAT_BYTES_IN, got);
+	}
+}
+
+/* Ouvre le fichier d'entrée une seule fois : il est projeté en mémoire si
+possible, sinon lu par grands blocs. Les deux passes (fréquences puis
+encodage) travaillent ensuite sur les mêmes octets. st_size est un off_t
+64 bits (_FILE_OFFSET_BITS=64) ; un fichier plus grand que l'espace
+d'adressage n'est pas projeté */
+InputBuffer	*open_input(const char *path)
+{
+	InputBuffer	*input;
+	int			fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return (NULL);
+	input = open_input_fd(fd);
+	close(fd);
+	return (input);
+}
+
+// Même chose sur un descripteur déjà ouvert (0 pour l'entrée standard), qui reste ouvert
+InputBuffer	*open_input_fd(int fd)
+{
+	InputBuffer	*input;
+	struct stat	file_info;
+	void		*map;
+
+	input = calloc(1, sizeof(InputBuffer));
+	if (!input)
+		return (NULL);
+	if (fstat(fd, &file_info) == 0 && S_ISREG(file_info.st_mode) && file_info.st_size > 0
+		&& (uint64_t)file_info.st_size <= SIZE_MAX)
+	{
+		map = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			// Les pages sont lues à la demande : leur coût tombe dans la phase qui les touche
+			madvise(map, file_info.st_size, MADV_SEQUENTIAL);
+			stats_count(STAT_READ_CALLS, 1);
+			stats_count(STAT_BYTES_IN, file_info.st_size);
+			input->data = map;
+			input->size = file_info.st_size;
+			input->mapped = true;
+			return (input);
+		}
+	}
+	if (!read_blocks(fd, input))
+	{
+		close_input(input);
+		return (NULL);
+	}
+	return (input);
+}
+
+void	close_input(InputBuffer *input)
+{
+	if (!input)
+		return;
+	if (input->mapped)
+		munmap(input->data, input->size);
+	else
+		free(input->data);
+	free(input);
+}
+
+/* Donne au fichier fd sa taille finale, size octets réservés sur le disque,
+puis le projette en écriture : le décodeur écrit directement dans le cache
+du système, sans buffer stdio ni appel d'écriture. La réservation évite
+qu'un disque plein ne se découvre qu'au milieu du décodage (SIGBUS) ; les
+systèmes de fichiers qui ne la gèrent pas s'en passent. Renvoie NULL en cas
+d'erreur ; la projection se libère avec munmap */
+unsigned char	*map_output(int fd, uint64_t size)
+{
+	void	*map;
+	int		error;
+
+	if (size == 0 || size > SIZE_MAX || ftruncate(fd, size) != 0)
+		return (NULL);
+	error = posix_fallocate(fd, 0, size);
+	if (error != 0 && error != EINVAL && error != EOPNOTSUPP)
+	{
+		errno = error;
+		return (NULL);
+	}
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return (NULL);
+	madvise(map, size, MADV_SEQUENTIAL);
+	return (map);
+}
+
+// Les écritures sont regroupées par blocs de IO_BLOCK_SIZE octets
+OutputBuffer	*open_output(FILE *file)
+{
+	OutputBuffer	*output;
+
+	output = malloc(sizeof(OutputBuffer));
+	if (!output)
+		return (NULL);
+	output->buffer = malloc(IO_BLOCK_SIZE);
+	if (!output->buffer)
+	{
+		free(output);
+		return (NULL);
+	}
+	output->file = file;
+	output->pos = 0;
+	output->error = false;
+	return (output);
+}
+
+bool	flush_output(OutputBuffer *output)
+{
+	uint64_t	start;
+
+	if (output->pos == 0)
+		return (!output->error);
+	// Sans fichier (décompress --verify), le résultat décodé est jeté
+	if (!output->file)
+	{
+		output->pos = 0;
+		return (!output->error);
+	}
+	start = stats_start();
+	if (fwrite(output->buffer, 1, output->pos, output->file) != output->pos)
+		output->error = true;
+	stats_stop(STAT_WRITE, start);
+	stats_count(STAT_WRITE_CALLS, 1);
+	stats_count(STAT_BYTES_OUT, output->pos);
+	output->pos = 0;
+	return (!output->error);
+}
+
+void	write_output(OutputBuffer *output, const void *data, size_t size)
+{
+	const unsigned char	*bytes;
+	size_t				chunk;
+
+	bytes = data;
+	while (size > 0)
+	{
+		if (output->pos == IO_BLOCK_SIZE)
+			flush_output(output);
+		chunk = IO_BLOCK_SIZE - output->pos;
+		if (chunk > size)
+			chunk = size;
+		memcpy(output->buffer + output->pos, bytes, chunk);
+		output->pos += chunk;
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+// Vide le buffer et le libère ; le FILE reste ouvert
+bool	close_output(OutputBuffer *output)
+{
+	bool	ok;
+
+	if (!output)
+		return (false);
+	ok = flush_output(output);
+	free(output->buffer);
+	free(output);
+	return (ok);
+}
+
+// Agrandit un buffer pour qu'il contienne au moins size octets
+bool	reserve_buffer(unsigned char **buffer, size_t *capacity, size_t size)
+{
+	unsigned char	*grown;
+
+	if (size <= *capacity)
+		return (true);
+	grown = realloc(*buffer, size);
+	if (!grown)
+		return (false);
+	*buffer = grown;
+	*capacity = size;
+	return (true);
+}
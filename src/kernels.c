@@ -0,0 +1,219 @@
+#include "../includes/huffman.h"
+
+/* Boucles spécialisées selon la longueur maximale des codes d'un bloc.
+Connaissant cette longueur, on sait combien de codes tiennent entre deux
+recharges du mot de bits (au décodage) ou deux écritures (au codage) : la
+boucle traite des groupes de taille fixe, déroulés par le compilateur, sans
+test par symbole. Chaque noyau est une instance d'une fonction inline dont
+la taille de groupe est une constante ; le choix se fait une fois par bloc
+(ou par appel) selon la table. Les noyaux s'arrêtent près de la fin des
+données ; la boucle générique termine */
+
+/* Recharge sans test : au moins 8 octets restent à lire. Après l'appel,
+le mot contient au moins 56 bits valides */
+static inline void	refill_word(BitReader *reader)
+{
+	uint64_t	word;
+
+	memcpy(&word, reader->data + reader->pos, sizeof(word));
+	reader->bits |= __builtin_bswap64(word) >> reader->count;
+	reader->pos += (63 - reader->count) >> 3;
+	reader->count |= 56;
+}
+
+// Lit un code de la table (longueur au plus DECODE_TABLE_BITS, donc toujours résolue)
+static inline unsigned char	lookup_symbol(BitReader *reader, const DecodeTable *table)
+{
+	uint16_t	entry;
+
+	entry = table->entries[reader->bits >> (64 - DECODE_TABLE_BITS)];
+	reader->bits <<= entry >> 8;
+	reader->count -= entry >> 8;
+	return (entry);
+}
+
+/* Décode des groupes de group symboles par recharge, tant qu'il reste
+group symboles à produire et 8 octets à lire. Renvoie le nombre décodé */
+static inline __attribute__((always_inline)) size_t	decode_groups(BitReader *reader,
+	const DecodeTable *restrict table, unsigned char *restrict dst, size_t count, int group)
+{
+	BitReader	local;
+	size_t		i;
+
+	local = *reader;
+	for (i = 0; i + group <= count && local.size - local.pos >= sizeof(uint64_t); i += group)
+	{
+		refill_word(&local);
+		for (int k = 0; k < group; k++)
+			dst[i + k] = lookup_symbol(&local, table);
+	}
+	*reader = local;
+	return (i);
+}
+
+/* Même chose sur les SPLIT_STREAMS flux d'un bloc : à chaque tour, les
+quatre lecteurs sont rechargés puis group symboles sont lus dans chacun,
+en alternant les flux pour que les lectures de table se recouvrent */
+static inline __attribute__((always_inline)) size_t	decode_split_groups(BitReader *readers,
+	const DecodeTable *restrict table, unsigned char *restrict dst, size_t quarter, size_t count,
+	int group)
+{
+	BitReader	r0, r1, r2, r3;
+	size_t		j;
+
+	r0 = readers[0];
+	r1 = readers[1];
+	r2 = readers[2];
+	r3 = readers[3];
+	for (j = 0; j + group <= count && r0.size - r0.pos >= sizeof(uint64_t)
+		&& r1.size - r1.pos >= sizeof(uint64_t) && r2.size - r2.pos >= sizeof(uint64_t)
+		&& r3.size - r3.pos >= sizeof(uint64_t); j += group)
+	{
+		refill_word(&r0);
+		refill_word(&r1);
+		refill_word(&r2);
+		refill_word(&r3);
+		for (int k = 0; k < group; k++)
+		{
+			dst[j + k] = lookup_symbol(&r0, table);
+			dst[quarter + j + k] = lookup_symbol(&r1, table);
+			dst[2 * quarter + j + k] = lookup_symbol(&r2, table);
+			dst[3 * quarter + j + k] = lookup_symbol(&r3, table);
+		}
+	}
+	readers[0] = r0;
+	readers[1] = r1;
+	readers[2] = r2;
+	readers[3] = r3;
+	return (j);
+}
+
+/* Ajoute des groupes de group codes à l'accumulateur, puis écrit ses octets
+entiers d'un seul mot : il reste au plus 7 bits, et group codes de la
+longueur maximale tiennent dans les 57 autres. Renvoie le nombre codé */
+static inline __attribute__((always_inline)) size_t	encode_groups(BitWriter *writer,
+	const unsigned char *restrict data, size_t size, const HuffmanCode *restrict codes, int group)
+{
+	const HuffmanCode	*code;
+	unsigned char		*dst;
+	uint64_t			bits, word;
+	uint32_t			count;
+	size_t				pos, i;
+
+	dst = writer->dst;
+	bits = writer->bits;
+	count = writer->count;
+	pos = writer->pos;
+	// Les bits au-delà de count sont ignorés : ils sortent du mot au décalage
+	if (count >= 8)
+	{
+		word = __builtin_bswap64(bits << (64 - count));
+		memcpy(dst + pos, &word, sizeof(word));
+		pos += count >> 3;
+		count &= 7;
+	}
+	for (i = 0; i + group <= size; i += group)
+	{
+		for (int k = 0; k < group; k++)
+		{
+			code = &codes[data[i + k]];
+			bits = (bits << code->length) | code->code;
+			count += code->length;
+		}
+		word = __builtin_bswap64(bits << (64 - count));
+		memcpy(dst + pos, &word, sizeof(word));
+		pos += count >> 3;
+		count &= 7;
+	}
+	writer->bits = bits;
+	writer->count = count;
+	writer->pos = pos;
+	return (i);
+}
+
+// Instances : une par nombre de codes par groupe
+#define DECODE_KERNEL(group) \
+	static size_t	decode_kernel_##group(BitReader *reader, const DecodeTable *table, \
+		unsigned char *dst, size_t count) \
+	{ \
+		return (decode_groups(reader, table, dst, count, group)); \
+	} \
+	static size_t	split_kernel_##group(BitReader *readers, const DecodeTable *table, \
+		unsigned char *dst, size_t quarter, size_t count) \
+	{ \
+		return (decode_split_groups(readers, table, dst, quarter, count, group)); \
+	}
+
+#define ENCODE_KERNEL(group) \
+	static size_t	encode_kernel_##group(BitWriter *writer, const unsigned char *data, size_t size, \
+		const HuffmanCode *codes) \
+	{ \
+		return (encode_groups(writer, data, size, codes, group)); \
+	}
+
+DECODE_KERNEL(8)
+DECODE_KERNEL(7)
+DECODE_KERNEL(6)
+DECODE_KERNEL(5)
+
+ENCODE_KERNEL(8)
+ENCODE_KERNEL(7)
+ENCODE_KERNEL(6)
+ENCODE_KERNEL(5)
+ENCODE_KERNEL(4)
+ENCODE_KERNEL(3)
+ENCODE_KERNEL(2)
+
+/* Une recharge garantit 56 bits : 56 / longueur codes par groupe, au plus
+8. Au-delà de DECODE_TABLE_BITS, un code peut demander le chemin lent */
+static const DecodeKernel	g_decode_kernels[DECODE_TABLE_BITS + 1] = {NULL,
+	decode_kernel_8, decode_kernel_8, decode_kernel_8, decode_kernel_8, decode_kernel_8,
+	decode_kernel_8, decode_kernel_8, decode_kernel_7, decode_kernel_6, decode_kernel_5,
+	decode_kernel_5};
+
+static const SplitKernel	g_split_kernels[DECODE_TABLE_BITS + 1] = {NULL,
+	split_kernel_8, split_kernel_8, split_kernel_8, split_kernel_8, split_kernel_8,
+	split_kernel_8, split_kernel_8, split_kernel_7, split_kernel_6, split_kernel_5,
+	split_kernel_5};
+
+// Au codage, 57 bits sont libres après l'écriture d'un mot
+static const EncodeKernel	g_encode_kernels[] = {NULL,
+	encode_kernel_8, encode_kernel_8, encode_kernel_8, encode_kernel_8, encode_kernel_8,
+	encode_kernel_8, encode_kernel_8, encode_kernel_7, encode_kernel_6, encode_kernel_5,
+	encode_kernel_5, encode_kernel_4, encode_kernel_4, encode_kernel_4, encode_kernel_3,
+	encode_kernel_3, encode_kernel_3, encode_kernel_3, encode_kernel_3, encode_kernel_2,
+	encode_kernel_2, encode_kernel_2, encode_kernel_2, encode_kernel_2, encode_kernel_2,
+	encode_kernel_2, encode_kernel_2, encode_kernel_2};
+
+/* Les noyaux de décodage supposent que chaque entrée de la table donne un
+symbole : codes canoniques complets (build_canonical_decode_table le
+vérifie) d'au plus DECODE_TABLE_BITS bits. Le code d'un bit d'un symbole
+seul laisse la moitié de la table vide et reste au chemin générique */
+static bool	kernel_table(const DecodeTable *table)
+{
+	return (!table->tree && table->max_length > 0 && table->max_length <= DECODE_TABLE_BITS
+		&& (table->max_length > 1 || table->count[1] == 2));
+}
+
+// Noyau de décodage adapté à table, NULL si seule la boucle générique convient
+DecodeKernel	decode_kernel(const DecodeTable *table)
+{
+	if (!kernel_table(table))
+		return (NULL);
+	return (g_decode_kernels[table->max_length]);
+}
+
+SplitKernel	split_kernel(const DecodeTable *table)
+{
+	if (!kernel_table(table))
+		return (NULL);
+	return (g_split_kernels[table->max_length]);
+}
+
+// Noyau de codage pour des codes d'au plus max_length bits, NULL si inconnue ou trop grande
+EncodeKernel	encode_kernel(int max_length)
+{
+	if (max_length <= 0 || max_length >= (int)(sizeof(g_encode_kernels) / sizeof(g_encode_kernels[0])))
+		return (NULL);
+	return (g_encode_kernels[max_length]);
+}
@@ -0,0 +1,138 @@
+#include "../includes/huffman.h"
+
+// Prend l'indice de la tâche suivante, ou renvoie false s'il n'y en a plus
+static bool	take_job(ThreadPool *pool, size_t *index)
+{
+	bool	found;
+
+	pthread_mutex_lock(&pool->lock);
+	found = pool->next_job < pool->job_count;
+	if (found)
+		*index = pool->next_job++;
+	pthread_mutex_unlock(&pool->lock);
+	return (found);
+}
+
+// Exécute les tâches du lot courant jusqu'à ce qu'il n'en reste plus
+static void	run_jobs(ThreadPool *pool)
+{
+	size_t	index;
+
+	while (take_job(pool, &index))
+	{
+		pool->job(pool->context, index);
+		pthread_mutex_lock(&pool->lock);
+		if (++pool->done_jobs == pool->job_count)
+			pthread_cond_broadcast(&pool->finished);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+// Boucle d'un thread : attend un nouveau lot, l'exécute, recommence
+static void	*worker_main(void *arg)
+{
+	ThreadPool	*pool;
+	uint64_t	generation;
+
+	pool = arg;
+	generation = 0;
+	while (1)
+	{
+		pthread_mutex_lock(&pool->lock);
+		while (pool->generation == generation && !pool->stopping)
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+		if (pool->stopping)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			return (NULL);
+		}
+		generation = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+		run_jobs(pool);
+	}
+}
+
+/* Crée un groupe de threads. Le thread appelant participe aussi aux lots :
+threads - 1 threads sont lancés. Avec threads <= 1, rien n'est lancé et les
+lots s'exécutent dans le thread appelant */
+ThreadPool	*pool_create(int threads)
+{
+	ThreadPool	*pool;
+
+	pool = calloc(1, sizeof(ThreadPool));
+	if (!pool)
+		return (NULL);
+	if (threads < 1)
+		threads = 1;
+	pool->workers = malloc(threads * sizeof(pthread_t));
+	if (!pool->workers)
+	{
+		free(pool);
+		return (NULL);
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wakeup, NULL);
+	pthread_cond_init(&pool->finished, NULL);
+	pool->thread_count = 1;
+	for (int i = 1; i < threads; i++)
+	{
+		if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0)
+			break;
+		pool->thread_count++;
+	}
+	return (pool);
+}
+
+/* Exécute job(context, i) pour i de 0 à count - 1 sur les threads du groupe
+et attend la fin de toutes les tâches. pool peut être NULL */
+void	pool_run(ThreadPool *pool, size_t count, void (*job)(void *, size_t), void *context)
+{
+	if (!pool || pool->thread_count == 1 || count <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			job(context, i);
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->context = context;
+	pool->job_count = count;
+	pool->next_job = 0;
+	pool->done_jobs = 0;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+	run_jobs(pool);
+	pthread_mutex_lock(&pool->lock);
+	while (pool->done_jobs < pool->job_count)
+		pthread_cond_wait(&pool->finished, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void	pool_destroy(ThreadPool *pool)
+{
+	if (!pool)
+		return;
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 1; i < pool->thread_count; i++)
+		pthread_join(pool->workers[i], NULL);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wakeup);
+	pthread_cond_destroy(&pool->finished);
+	free(pool->workers);
+	free(pool);
+}
+
+// Nombre de threads demandé par l'option -T : 0 signifie un par processeur
+int	resolve_thread_count(int requested)
+{
+	long	cpus;
+
+	if (requested > 0)
+		return (requested);
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus > 0 ? (int)cpus : 1);
+}
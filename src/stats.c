@@ -0,0 +1,94 @@
+#include "../includes/huffman.h"
+
+/* Mesures en cours, NULL quand l'instrumentation est désactivée : chaque
+point de mesure se réduit alors à un test de ce pointeur. Les points sont
+placés par bloc ou par appel d'entrée-sortie, jamais dans les boucles de
+symboles */
+static HuffStats	*g_stats = NULL;
+
+static const char	*g_phase_names[STAT_PHASES] = {"read", "histogram", "tree", "codes", "encode",
+	"decode", "write", "checksum"};
+
+static const char	*g_counter_names[STAT_COUNTERS] = {"bytes_in", "bytes_out", "read_calls",
+	"write_calls", "blocks", "stored_blocks", "symbols", "coded_bytes", "coded_bits"};
+
+// Active les mesures dans stats (remis à zéro), ou les désactive avec NULL
+void	huff_stats_enable(HuffStats *stats)
+{
+	if (stats)
+		memset(stats, 0, sizeof(HuffStats));
+	g_stats = stats;
+}
+
+// Début d'une phase : horloge monotone en nanosecondes, 0 sans mesures
+uint64_t	stats_start(void)
+{
+	struct timespec	ts;
+
+	if (!g_stats)
+		return (0);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+// Les blocs sont compressés et décodés par plusieurs threads : ajouts atomiques
+void	stats_stop(int phase, uint64_t start)
+{
+	if (!g_stats)
+		return;
+	__atomic_fetch_add(&g_stats->phase_ns[phase], stats_start() - start, __ATOMIC_RELAXED);
+}
+
+void	stats_count(int counter, uint64_t value)
+{
+	if (!g_stats)
+		return;
+	__atomic_fetch_add(&g_stats->counters[counter], value, __ATOMIC_RELAXED);
+}
+
+// Retient la plus longue des longueurs de codes d'une table
+void	stats_code_lengths(const uint8_t *lengths)
+{
+	uint32_t	longest, current;
+
+	if (!g_stats)
+		return;
+	longest = 0;
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (lengths[i] > longest)
+			longest = lengths[i];
+	current = __atomic_load_n(&g_stats->max_code_length, __ATOMIC_RELAXED);
+	while (longest > current && !__atomic_compare_exchange_n(&g_stats->max_code_length, &current,
+			longest, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/* Écrit les mesures dans file, en un objet JSON ("json") ou en lignes
+clé=valeur ("text"). La longueur moyenne des codes ne compte que les blocs
+codés avec une seule table. Renvoie false si le format est inconnu */
+bool	print_stats(FILE *file, const HuffStats *stats, const char *mode, const char *format)
+{
+	const char	*separator, *end;
+	double		average;
+	bool		json;
+
+	json = strcmp(format, "json") == 0;
+	if (!json && strcmp(format, "text") != 0)
+		return (false);
+	separator = json ? ", " : "\n";
+	end = json ? "\": " : "=";
+	average = stats->counters[STAT_CODED_BYTES] > 0
+		? (double)stats->counters[STAT_CODED_BITS] / stats->counters[STAT_CODED_BYTES] : 0;
+	fprintf(file, json ? "{\"mode\": \"%s\"" : "mode=%s", mode);
+	for (int i = 0; i < STAT_PHASES; i++)
+		fprintf(file, "%s%s%s_ms%s%.3f", separator, json ? "\"" : "", g_phase_names[i], end,
+			stats->phase_ns[i] / 1e6);
+	for (int i = 0; i < STAT_COUNTERS; i++)
+		fprintf(file, "%s%s%s%s%" PRIu64, separator, json ? "\"" : "", g_counter_names[i], end,
+			stats->counters[i]);
+	fprintf(file, "%s%smax_code_length%s%" PRIu32, separator, json ? "\"" : "", end,
+		stats->max_code_length);
+	fprintf(file, "%s%savg_code_length%s%.3f%s\n", separator, json ? "\"" : "", end, average,
+		json ? "}" : "");
+	return (true);
+}
@@ -0,0 +1,383 @@
+#include "../includes/huffman.h"
+
+/* Prépare un flux dans le sens demandé. Le format produit et accepté est
+celui de l'outil compress (blocs contrôlés, version 5) ; la décompression
+accepte aussi les versions 2 et 3. Un bloc de version 5 est rendu au fil
+des appels, comme les autres : son CRC32C est calculé sur les octets rendus
+et comparé à la fin du bloc, si bien qu'un bloc corrompu est signalé par
+HUFF_ERROR_CORRUPT après que ses octets ont été rendus */
+int	huff_stream_init(HuffStream *stream, int mode)
+{
+	memset(stream, 0, sizeof(HuffStream));
+	stream->mode = mode;
+	stream->options.max_code_length = DEFAULT_CODE_LENGTH_LIMIT;
+	if (mode == HUFF_STREAM_DECOMPRESS)
+		return (HUFF_OK);
+	// La signature est la première sortie du flux de compression
+	if (!reserve_buffer(&stream->block, &stream->block_capacity, HUFF_BLOCK_SIZE)
+		|| !reserve_buffer(&stream->pending, &stream->pending_capacity,
+			2 * sizeof(uint32_t) + HUFF_BLOCK_BOUND(HUFF_BLOCK_SIZE)))
+	{
+		huff_stream_free(stream);
+		return (HUFF_ERROR_MEMORY);
+	}
+	memcpy(stream->pending, HUFF_MAGIC, 3);
+	stream->pending[3] = HUFF_VERSION_CHECKED;
+	stream->pending_size = 4;
+	return (HUFF_OK);
+}
+
+void	huff_stream_free(HuffStream *stream)
+{
+	free(stream->block);
+	free(stream->raw);
+	free(stream->pending);
+	huff_arena_free(&stream->arena);
+	memset(stream, 0, sizeof(HuffStream));
+}
+
+// Copie dans out ce qui reste de la sortie en attente
+static void	drain_pending(HuffStream *stream, unsigned char *out, size_t capacity, size_t *produced)
+{
+	size_t	chunk;
+
+	chunk = stream->pending_size - stream->pending_pos;
+	if (chunk > capacity - *produced)
+		chunk = capacity - *produced;
+	memcpy(out + *produced, stream->pending + stream->pending_pos, chunk);
+	stream->pending_pos += chunk;
+	*produced += chunk;
+	if (stream->pending_pos == stream->pending_size)
+	{
+		stream->pending_pos = 0;
+		stream->pending_size = 0;
+	}
+}
+
+// Compresse le bloc accumulé dans la sortie en attente, précédé de son en-tête
+static int	encode_pending_block(HuffStream *stream)
+{
+	uint32_t	header[2];
+	bool		seen[MAX_SYMBOLS];
+
+	header[0] = stream->block_fill;
+	huff_arena_reset(&stream->arena);
+	header[1] = encode_block(stream->block, stream->block_fill,
+			stream->pending + sizeof(header), seen, &stream->options, &stream->arena);
+	header[1] = append_checksum(stream->block, stream->block_fill, stream->pending + sizeof(header),
+			header[1]);
+	if (header[1] == 0)
+		return (HUFF_ERROR_MEMORY);
+	memcpy(stream->pending, header, sizeof(header));
+	stream->pending_size = sizeof(header) + header[1];
+	stream->block_fill = 0;
+	return (HUFF_OK);
+}
+
+/* Rend la sortie en attente puis, si elle a été rendue en entier, compresse
+le bloc en cours, même incomplet, et en rend ce qui tient dans out */
+static int	flush_block(HuffStream *stream, unsigned char *out, size_t capacity, size_t *produced)
+{
+	int	status;
+
+	drain_pending(stream, out, capacity, produced);
+	if (stream->pending_size > 0 || stream->block_fill == 0)
+		return (HUFF_OK);
+	status = encode_pending_block(stream);
+	if (status == HUFF_OK)
+		drain_pending(stream, out, capacity, produced);
+	return (status);
+}
+
+/* Compression : les octets reçus remplissent le bloc courant ; un bloc plein
+est compressé dans la sortie en attente, rendue dès qu'il y a de la place.
+Un seul bloc compressé est en attente à la fois */
+static int	compress_update(HuffStream *stream, const unsigned char *in, size_t *in_size,
+	unsigned char *out, size_t *out_size)
+{
+	size_t	consumed, produced, chunk;
+	int		status;
+
+	consumed = 0;
+	produced = 0;
+	status = HUFF_OK;
+	while (status == HUFF_OK)
+	{
+		drain_pending(stream, out, *out_size, &produced);
+		if (stream->pending_size > 0)
+			break;
+		chunk = HUFF_BLOCK_SIZE - stream->block_fill;
+		if (chunk > *in_size - consumed)
+			chunk = *in_size - consumed;
+		memcpy(stream->block + stream->block_fill, in + consumed, chunk);
+		stream->block_fill += chunk;
+		stream->total += chunk;
+		consumed += chunk;
+		if (stream->block_fill < HUFF_BLOCK_SIZE)
+			break;
+		status = encode_pending_block(stream);
+	}
+	*in_size = consumed;
+	*out_size = produced;
+	return (status);
+}
+
+/* Accumule dans stream->header les octets d'un champ de taille fixe.
+Renvoie true quand le champ est complet */
+static bool	read_field(HuffStream *stream, const unsigned char *in, size_t in_size,
+	size_t *consumed, size_t size)
+{
+	size_t	chunk;
+
+	chunk = size - stream->header_fill;
+	if (chunk > in_size - *consumed)
+		chunk = in_size - *consumed;
+	memcpy(stream->header + stream->header_fill, in + *consumed, chunk);
+	stream->header_fill += chunk;
+	*consumed += chunk;
+	if (stream->header_fill < size)
+		return (false);
+	stream->header_fill = 0;
+	return (true);
+}
+
+// En-tête de bloc complet : prépare la réception du contenu compressé
+static int	start_block(HuffStream *stream)
+{
+	uint32_t	header[2];
+
+	memcpy(header, stream->header, sizeof(header));
+	if (header[0] == 0)
+	{
+		stream->state = stream->version == HUFF_VERSION_BLOCKS ? STREAM_DONE : STREAM_TRAILER;
+		return (HUFF_OK);
+	}
+	// Un bloc a au moins un octet de contenu (marque ou table)
+	if (header[0] > HUFF_MAX_BLOCK_SIZE || header[1] == 0 || header[1] > HUFF_BLOCK_BOUND(header[0]))
+		return (HUFF_ERROR_CORRUPT);
+	if (!reserve_buffer(&stream->block, &stream->block_capacity, header[1]))
+		return (HUFF_ERROR_MEMORY);
+	stream->raw_size = header[0];
+	stream->block_size = header[1];
+	stream->block_fill = 0;
+	stream->state = STREAM_PACKED;
+	return (HUFF_OK);
+}
+
+/* Contenu compressé complet : lit la table du bloc et place le lecteur de
+bits. Un bloc stocké est rendu par copie depuis block ; un bloc à flux
+multiples est décodé d'un coup dans raw, puis rendu par copie. En version 5,
+le CRC32C qui termine le contenu est mis de côté pour la fin du bloc.
+Les tables du bloc précédent sont rendues à l'arène du flux */
+static int	start_symbols(HuffStream *stream)
+{
+	uint8_t	lengths[MAX_SYMBOLS];
+	size_t	used;
+
+	stream->remaining = stream->raw_size;
+	stream->table = NULL;
+	memset(stream->contexts, 0, sizeof(stream->contexts));
+	huff_arena_reset(&stream->arena);
+	if (stream->version == HUFF_VERSION_CHECKED)
+	{
+		if (stream->block_size <= CHECKSUM_SIZE)
+			return (HUFF_ERROR_CORRUPT);
+		stream->block_size -= CHECKSUM_SIZE;
+		memcpy(&stream->expected_crc, stream->block + stream->block_size, CHECKSUM_SIZE);
+		stream->crc = 0;
+	}
+	if (stream->block_size > 0 && stream->block[0] == STORED_BLOCK)
+	{
+		if (stream->block_size != stream->raw_size + 1)
+			return (HUFF_ERROR_CORRUPT);
+		stream->copy = stream->block + 1;
+		stream->state = STREAM_COPY;
+		return (HUFF_OK);
+	}
+	if (stream->block_size > 0 && stream->block[0] == SPLIT_BLOCK)
+	{
+		if (!reserve_buffer(&stream->raw, &stream->raw_capacity, stream->raw_size))
+			return (HUFF_ERROR_MEMORY);
+		if (!decode_split_block(stream->block, stream->block_size, stream->raw, stream->raw_size,
+				&stream->arena))
+			return (HUFF_ERROR_CORRUPT);
+		stream->copy = stream->raw;
+		stream->state = STREAM_COPY;
+		return (HUFF_OK);
+	}
+	stream->context = stream->block_size > 0 && stream->block[0] == CONTEXT_BLOCK;
+	if (stream->context)
+	{
+		used = read_context_tables(stream->block, stream->block_size, stream->contexts, &stream->arena);
+		if (used == 0)
+			return (HUFF_ERROR_CORRUPT);
+		init_block_reader(&stream->reader, stream->block + used, stream->block_size - used);
+		stream->previous = 0;
+		stream->state = STREAM_SYMBOLS;
+		return (HUFF_OK);
+	}
+	used = read_code_lengths(stream->block, stream->block_size, lengths);
+	stream->table = used ? build_canonical_decode_table(lengths, &stream->arena) : NULL;
+	if (!stream->table)
+		return (HUFF_ERROR_CORRUPT);
+	init_block_reader(&stream->reader, stream->block + used, stream->block_size - used);
+	stream->state = STREAM_SYMBOLS;
+	return (HUFF_OK);
+}
+
+/* Décompression : automate qui avance tant qu'il reste de l'entrée à lire ou
+de la place pour les symboles décodés. Le contenu compressé d'un bloc est
+gardé jusqu'à ce qu'il soit complet, puis décodé directement dans out ; le
+lecteur de bits et le nombre de symboles restants permettent de reprendre
+le bloc à l'appel suivant quand out est plein. En version 5, le CRC32C des
+octets rendus est prolongé à chaque morceau et vérifié au dernier */
+static int	decompress_update(HuffStream *stream, const unsigned char *in, size_t *in_size,
+	unsigned char *out, size_t *out_size)
+{
+	size_t		consumed, produced, chunk;
+	uint64_t	total;
+	int			status;
+
+	consumed = 0;
+	produced = 0;
+	status = HUFF_OK;
+	while (status == HUFF_OK && stream->state != STREAM_DONE)
+	{
+		if (stream->state == STREAM_SYMBOLS || stream->state == STREAM_COPY)
+		{
+			chunk = stream->remaining < *out_size - produced ? stream->remaining : *out_size - produced;
+			if (chunk == 0)
+				break;
+			if (stream->state == STREAM_COPY)
+				memcpy(out + produced, stream->copy + stream->raw_size - stream->remaining, chunk);
+			else if (stream->context)
+			{
+				if (!decode_context_symbols(&stream->reader, stream->contexts, &stream->previous,
+						out + produced, chunk))
+					status = HUFF_ERROR_CORRUPT;
+			}
+			else if (!decode_symbols(&stream->reader, stream->table, out + produced, chunk))
+				status = HUFF_ERROR_CORRUPT;
+			if (stream->version == HUFF_VERSION_CHECKED)
+				stream->crc = crc32c_update(stream->crc, out + produced, chunk);
+			produced += chunk;
+			stream->total += chunk;
+			stream->remaining -= chunk;
+			if (stream->remaining == 0)
+				stream->state = STREAM_BLOCK_HEADER;
+			if (stream->remaining == 0 && stream->version == HUFF_VERSION_CHECKED
+				&& stream->crc != stream->expected_crc)
+				status = HUFF_ERROR_CORRUPT;
+			continue;
+		}
+		if (consumed == *in_size)
+			break;
+		if (stream->state == STREAM_SIGNATURE && read_field(stream, in, *in_size, &consumed, 4))
+		{
+			stream->version = stream->header[3];
+			if (memcmp(stream->header, HUFF_MAGIC, 3) != 0
+				|| (stream->version != HUFF_VERSION_BLOCKS && stream->version != HUFF_VERSION_LARGE
+					&& stream->version != HUFF_VERSION_CHECKED))
+				status = HUFF_ERROR_CORRUPT;
+			stream->state = STREAM_BLOCK_HEADER;
+		}
+		else if (stream->state == STREAM_BLOCK_HEADER
+			&& read_field(stream, in, *in_size, &consumed, 2 * sizeof(uint32_t)))
+			status = start_block(stream);
+		else if (stream->state == STREAM_PACKED)
+		{
+			chunk = stream->block_size - stream->block_fill;
+			if (chunk > *in_size - consumed)
+				chunk = *in_size - consumed;
+			memcpy(stream->block + stream->block_fill, in + consumed, chunk);
+			stream->block_fill += chunk;
+			consumed += chunk;
+			if (stream->block_fill == stream->block_size)
+				status = start_symbols(stream);
+		}
+		else if (stream->state == STREAM_TRAILER
+			&& read_field(stream, in, *in_size, &consumed, sizeof(total)))
+		{
+			memcpy(&total, stream->header, sizeof(total));
+			if (total != stream->total)
+				status = HUFF_ERROR_CORRUPT;
+			stream->state = STREAM_DONE;
+		}
+	}
+	// Ce qui suit la fin du flux (index des blocs) est lu sans être décodé
+	if (status == HUFF_OK && stream->state == STREAM_DONE)
+		consumed = *in_size;
+	*in_size = consumed;
+	*out_size = produced;
+	return (status);
+}
+
+/* Pousse *in_size octets de in dans le flux et écrit au plus *out_size octets
+dans out. En retour, *in_size et *out_size donnent les octets lus et écrits :
+l'entrée non lue doit être présentée de nouveau à l'appel suivant */
+int	huff_stream_update(HuffStream *stream, const void *in, size_t *in_size, void *out, size_t *out_size)
+{
+	if (stream->mode == HUFF_STREAM_COMPRESS)
+		return (compress_update(stream, in, in_size, out, out_size));
+	return (decompress_update(stream, in, in_size, out, out_size));
+}
+
+/* Compression : compresse tout de suite le bloc en cours, même incomplet,
+pour que les octets déjà reçus soient décodables à partir de la sortie
+rendue, puis écrit ce qui tient dans out. Renvoie HUFF_MORE tant que le
+bloc n'a pas été rendu en entier. Chaque vidage termine un bloc : des
+vidages fréquents coûtent une table de codes par bloc. En décompression,
+ne fait rien : les octets décodés sont déjà rendus à chaque appel */
+int	huff_stream_flush(HuffStream *stream, void *out, size_t *out_size)
+{
+	size_t	produced;
+	int		status;
+
+	if (stream->mode == HUFF_STREAM_DECOMPRESS)
+	{
+		*out_size = 0;
+		return (HUFF_OK);
+	}
+	produced = 0;
+	status = flush_block(stream, out, *out_size, &produced);
+	*out_size = produced;
+	if (status != HUFF_OK)
+		return (status);
+	return (stream->pending_size == 0 ? HUFF_OK : HUFF_MORE);
+}
+
+/* Termine le flux. En compression, écrit le dernier bloc, le bloc de fin et
+la taille totale ; renvoie HUFF_MORE tant que tout n'a pas tenu dans out.
+En décompression, rend les symboles restants et vérifie que le flux est
+complet. Le contexte doit ensuite être libéré avec huff_stream_free */
+int	huff_stream_finish(HuffStream *stream, void *out, size_t *out_size)
+{
+	size_t		produced, none;
+	uint32_t	end[2] = {0, 0};
+	int			status;
+
+	if (stream->mode == HUFF_STREAM_DECOMPRESS)
+	{
+		none = 0;
+		status = decompress_update(stream, NULL, &none, out, out_size);
+		if (status == HUFF_OK && (stream->state == STREAM_SYMBOLS || stream->state == STREAM_COPY))
+			return (HUFF_MORE);
+		if (status == HUFF_OK && stream->state != STREAM_DONE)
+			return (HUFF_ERROR_CORRUPT);
+		return (status);
+	}
+	produced = 0;
+	status = flush_block(stream, out, *out_size, &produced);
+	if (status != HUFF_OK)
+		return (status);
+	if (stream->pending_size == 0 && stream->state != STREAM_DONE)
+	{
+		memcpy(stream->pending, end, sizeof(end));
+		memcpy(stream->pending + sizeof(end), &stream->total, sizeof(stream->total));
+		stream->pending_size = sizeof(end) + sizeof(stream->total);
+		stream->state = STREAM_DONE;
+		drain_pending(stream, out, *out_size, &produced);
+	}
+	*out_size = produced;
+	return (stream->pending_size == 0 ? HUFF_OK : HUFF_MORE);
+}
@@ -0,0 +1,111 @@
+#include "../includes/huffman.h"
+
+/* Ajoute un noeud à la fin du tableau de l'arbre. left et right valent -1
+pour une feuille. Renvoie l'indice du noeud, ou -1 si le tableau est plein */
+int	add_node(HuffmanTree *tree, unsigned char c, uint64_t freq, int left, int right)
+{
+	HuffmanNode	*node;
+
+	if (tree->count == HUFFMAN_TREE_SIZE)
+		return (-1);
+	node = &tree->nodes[tree->count];
+	node->character = c;
+	node->frequency = freq;
+	node->left = left;
+	node->right = right;
+	node->is_leaf = left < 0 && right < 0;
+	return (tree->count++);
+}
+
+// Ordre des feuilles : fréquence croissante, puis valeur du symbole
+static int	compare_leaves(const void *a, const void *b)
+{
+	const HuffmanNode	*x = a;
+	const HuffmanNode	*y = b;
+
+	if (x->frequency != y->frequency)
+		return (x->frequency < y->frequency ? -1 : 1);
+	return (x->character - y->character);
+}
+
+/* Prend le plus petit noeud en tête de l'une des deux files : les feuilles
+triées (indices leaf à leaves - 1) ou les noeuds internes déjà créés, qui
+apparaissent par poids croissant (indices merged à tree->count - 1) */
+static int	take_smallest(HuffmanTree *tree, int *leaf, int leaves, int *merged)
+{
+	if (*leaf < leaves && (*merged == tree->count
+			|| tree->nodes[*leaf].frequency <= tree->nodes[*merged].frequency))
+		return ((*leaf)++);
+	return ((*merged)++);
+}
+
+/* Construit l'arbre de Huffman en O(k log k) : les k feuilles sont triées
+puis fusionnées avec deux files. Chaque parent a un poids au moins égal au
+précédent, la file des noeuds internes reste donc triée sans tas. Les 2k - 1
+noeuds sont rangés dans le tableau de tree, sans allocation ; la racine est
+le dernier. Renvoie false si aucun symbole n'est présent */
+bool	build_huffman_tree(const FrequencyTable *freq_table, HuffmanTree *tree)
+{
+	int	leaves, leaf, merged, first, second;
+
+	tree->count = 0;
+	tree->root = -1;
+	if (!freq_table || !freq_table->frequencies)
+		return (false);
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (freq_table->frequencies[i] > 0)
+			add_node(tree, i, freq_table->frequencies[i], -1, -1);
+	leaves = tree->count;
+	if (leaves == 0)
+		return (false);
+	qsort(tree->nodes, leaves, sizeof(HuffmanNode), compare_leaves);
+	leaf = 0;
+	merged = leaves;
+	while (tree->count < 2 * leaves - 1)
+	{
+		first = take_smallest(tree, &leaf, leaves, &merged);
+		second = take_smallest(tree, &leaf, leaves, &merged);
+		add_node(tree, 0, tree->nodes[first].frequency + tree->nodes[second].frequency,
+			first, second);
+	}
+	tree->root = tree->count - 1;
+	return (true);
+}
+
+// Codes lus directement dans l'arbre (chemin racine-feuille), sans forme canonique
+void generate_codes_recursive(const HuffmanTree *tree, int index, uint64_t current_code, size_t depth, HuffmanTable *table) 
+{
+	const HuffmanNode	*node;
+
+	if (index < 0)
+		return;
+	node = &tree->nodes[index];
+	// Si nous sommes à un noeud feuille, stocker le code (aligné à droite)
+	if (node->is_leaf) 
+	{
+		table->codes[node->character].code = current_code;
+		table->codes[node->character].length = depth;
+		table->used[node->character] = true;
+		return;
+	}
+
+	// Parcourir à gauche (ajouter 0)
+	generate_codes_recursive(tree, node->left, current_code << 1, depth + 1, table);
+
+	// Parcourir à droite (ajouter 1)
+	generate_codes_recursive(tree, node->right, (current_code << 1) | 1, depth + 1, table);
+}
+
+HuffmanTable	*generate_huffman_codes(const HuffmanTree *tree)
+{
+	HuffmanTable	*table;
+
+	table = calloc(1, sizeof(HuffmanTable));
+	if (!table)
+		return (NULL);
+	generate_codes_recursive(tree, tree->root, 0, 0, table);
+	for (int i = 0; i < MAX_SYMBOLS; i++)
+		if (table->used[i] && (int)table->codes[i].length > table->max_length)
+			table->max_length = table->codes[i].length;
+	return (table);
+}